@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _ark43_h_
+#define _ark43_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+#include "stepcontrol.h"
+
+// implicit-explicit additive Runge-Kutta method ARK4(3)6L[2]SA of Kennedy and Carpenter
+// for u' = L u + N(u, t) with L diagonal. L u is treated with the L-stable, stiffly
+// accurate ESDIRK tableau and N(u, t) with the explicit one, so a stage is
+//
+// Y_i = (I - h gamma L)^{-1} (y + h sum_{j < i} (aE_ij N_j + aI_ij L Y_j))
+//
+// which for a diagonal L is a division per mode, and the step is limited by N instead
+// of by the largest |L_i|. both tableaus share b (fourth order) and the embedded third
+// order weights, the error estimate is h sum_j (b_j - bHat_j) (N_j + L Y_j), and the step
+// size control is the same as gsl_odeiv_control_y_new. Function is a functor for N with
+//
+// void operator()(double t, const double u[], double uDot[])
+
+namespace NAMESPACE {
+	template <class Function>
+	class ARK43 {
+	 public:
+        ARK43(void);
+		~ARK43(void) { };
+		
+		// initialize, linear is the diagonal of L
+		void Initialize(const Function &function, const Array<double> &linear, 
+						double absoluteError, double relativeError);
+		
+		// evolve y from t to t1, h is the suggested step size, updated on return
+		void Evolve(double &t, double t1, double &h, double y[]);
+		
+		// one accepted step from t, not past t1
+		void TakeStep(double &t, double t1, double &h, double y[]);
+		
+		// evaluations of N since Initialize
+		long NumEvaluations(void) const;
+		
+	private:
+		void Step(double t, double h, const double y[]);
+		
+		// member data
+	private:
+		Function mFunction;
+		long mSize;
+		
+		// linear part, and 1 / (1 - h gamma L_i) for the step size mDivisorStep
+		Array<double> mLinear;
+		Array<double> mDivisor;
+		double mDivisorStep;
+		
+		// explicit and implicit stage derivatives
+		Array<double> mExplicit[6];
+		Array<double> mImplicit[6];
+		Array<double> mYStage;
+		Array<double> mYNew;
+		Array<double> mYError;
+		
+		StepControl mStepControl;
+		long mNumEvaluations;
+		
+		// coefficients
+		static const double mGamma;
+		static const double mC[6];
+		static const double mAE[6][5];
+		static const double mAI[6][5];
+		static const double mB[6];
+		static const double mBHat[6];
+	};
+	
+	
+	
+	template <class Function>
+	const double ARK43<Function>::mGamma = 1.0 / 4.0;
+	
+	template <class Function>
+	const double ARK43<Function>::mC[6] = {0.0, 1.0 / 2.0, 83.0 / 250.0, 31.0 / 50.0, 17.0 / 20.0, 1.0};
+	
+	template <class Function>
+	const double ARK43<Function>::mAE[6][5] = {
+		{0.0, 0.0, 0.0, 0.0, 0.0},
+		{1.0 / 2.0, 0.0, 0.0, 0.0, 0.0},
+		{13861.0 / 62500.0, 6889.0 / 62500.0, 0.0, 0.0, 0.0},
+		{-116923316275.0 / 2393684061468.0, -2731218467317.0 / 15368042101831.0, 9408046702089.0 / 11113171139209.0, 0.0, 0.0},
+		{-451086348788.0 / 2902428689909.0, -2682348792572.0 / 7519795681897.0, 12662868775082.0 / 11960479115383.0, 
+		 3355817975965.0 / 11060851509271.0, 0.0},
+		{647845179188.0 / 3216320057751.0, 73281519250.0 / 8382639484533.0, 552539513391.0 / 3454668386233.0, 
+		 3354512671639.0 / 8306763924573.0, 4040.0 / 17871.0}
+	};
+	
+	// strictly lower part, the diagonal is gamma (except for the explicit first stage)
+	template <class Function>
+	const double ARK43<Function>::mAI[6][5] = {
+		{0.0, 0.0, 0.0, 0.0, 0.0},
+		{1.0 / 4.0, 0.0, 0.0, 0.0, 0.0},
+		{8611.0 / 62500.0, -1743.0 / 31250.0, 0.0, 0.0, 0.0},
+		{5012029.0 / 34652500.0, -654441.0 / 2922500.0, 174375.0 / 388108.0, 0.0, 0.0},
+		{15267082809.0 / 155376265600.0, -71443401.0 / 120774400.0, 730878875.0 / 902184768.0, 2285395.0 / 8070912.0, 0.0},
+		{82889.0 / 524892.0, 0.0, 15625.0 / 83664.0, 69875.0 / 102672.0, -2260.0 / 8211.0}
+	};
+	
+	template <class Function>
+	const double ARK43<Function>::mB[6] = {82889.0 / 524892.0, 0.0, 15625.0 / 83664.0, 69875.0 / 102672.0, 
+										   -2260.0 / 8211.0, 1.0 / 4.0};
+	
+	template <class Function>
+	const double ARK43<Function>::mBHat[6] = {4586570599.0 / 29645900160.0, 0.0, 178811875.0 / 945068544.0, 
+											  814220225.0 / 1159782912.0, -3700637.0 / 11593932.0, 61727.0 / 225920.0};
+	
+	
+	
+	template <class Function>
+	inline ARK43<Function>::ARK43()
+	{
+		mSize = 0;
+		mDivisorStep = 0.0;
+		mNumEvaluations = 0;
+		
+		return;
+	} 
+	
+	
+	
+	template <class Function>
+	void ARK43<Function>::Initialize(const Function &function, const Array<double> &linear, 
+									 double absoluteError, double relativeError)
+	{
+		if (linear.Size() <= 0)
+			ThrowException("ARK43::Initialize : empty linear part");
+		
+		mFunction = function;
+		mSize = linear.Size();
+		
+		mLinear = linear;
+		mDivisor.SetSize(mSize);
+		mDivisorStep = 0.0;
+		
+		for (short s = 0; s < 6; ++s) {
+			mExplicit[s].SetSize(mSize);
+			mImplicit[s].SetSize(mSize);
+		}
+		
+		mYStage.SetSize(mSize);
+		mYNew.SetSize(mSize);
+		mYError.SetSize(mSize);
+		
+		// the stepper order, as gsl gives its control
+		mStepControl.Initialize(absoluteError, relativeError, 4);
+		mNumEvaluations = 0;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline long ARK43<Function>::NumEvaluations() const
+	{
+		return mNumEvaluations;
+	}
+	
+	
+	
+	template <class Function>
+	void ARK43<Function>::Evolve(double &t, double t1, double &h, double y[])
+	{
+		while (t < t1)
+			TakeStep(t, t1, h, y);
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void ARK43<Function>::TakeStep(double &t, double t1, double &h, double y[])
+	{
+		if (t >= t1)
+			return;
+		
+		double hStep = h;
+		bool finalStep = false;
+		
+		if (t + hStep >= t1) {
+			hStep = t1 - t;
+			finalStep = true;
+		}
+		
+		StepAdjustment adjustment;
+		double hNew;
+		
+		while (true) {
+			Step(t, hStep, y);
+			
+			hNew = hStep;
+			double errorRatio = mStepControl.ErrorRatio(mYNew.Begin(), mYError.Begin(), mSize);
+			adjustment = mStepControl.AdjustStepSize(errorRatio, hNew);
+			
+			if (adjustment != STEP_DECREASE)
+				break;
+			
+			if (t + hNew == t)
+				ThrowException("ARK43::Evolve : step size underflow");
+			
+			hStep = hNew;
+			finalStep = false;
+		}
+		
+		for (long i = 0; i < mSize; ++i)
+			y[i] = mYNew[i];
+		
+		if (finalStep)
+			t = t1;
+		else
+			t += hStep;
+		
+		// a step shortened to land on t1 doesn't shrink the next step
+		if (finalStep == false || hNew > h)
+			h = hNew;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void ARK43<Function>::Step(double t, double h, const double y[])
+	{
+		if (h != mDivisorStep) {
+			for (long i = 0; i < mSize; ++i)
+				mDivisor[i] = 1.0 / (1.0 - h * mGamma * mLinear[i]);
+			
+			mDivisorStep = h;
+		}
+		
+		// the first stage is explicit
+		mFunction(t, y, mExplicit[0].Begin());
+		for (long i = 0; i < mSize; ++i)
+			mImplicit[0][i] = mLinear[i] * y[i];
+		
+		for (short s = 1; s < 6; ++s) {
+			double *yStage = mYStage.Begin();
+			
+			for (long i = 0; i < mSize; ++i)
+				yStage[i] = y[i];
+			
+			for (short j = 0; j < s; ++j) {
+				double aE = h * mAE[s][j];
+				double aI = h * mAI[s][j];
+				
+				const double *kE = mExplicit[j].Begin();
+				const double *kI = mImplicit[j].Begin();
+				for (long i = 0; i < mSize; ++i)
+					yStage[i] += aE * kE[i] + aI * kI[i];
+			}
+			
+			// the implicit solve
+			for (long i = 0; i < mSize; ++i) {
+				yStage[i] *= mDivisor[i];
+				mImplicit[s][i] = mLinear[i] * yStage[i];
+			}
+			
+			mFunction(t + mC[s] * h, yStage, mExplicit[s].Begin());
+		}
+		
+		mNumEvaluations += 6;
+		
+		for (long i = 0; i < mSize; ++i) {
+			mYNew[i] = y[i];
+			mYError[i] = 0.0;
+		}
+		
+		for (short s = 0; s < 6; ++s) {
+			double b = h * mB[s];
+			double e = h * (mB[s] - mBHat[s]);
+			
+			const double *kE = mExplicit[s].Begin();
+			const double *kI = mImplicit[s].Begin();
+			for (long i = 0; i < mSize; ++i) {
+				double k = kE[i] + kI[i];
+				mYNew[i] += b * k;
+				mYError[i] += e * k;
+			}
+		}
+		
+		return;
+	}
+}
+
+#endif // _ark43_h_
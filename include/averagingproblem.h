@@ -22,6 +22,7 @@
 
 #include "problem.h"
 #include "realmatrix.h"
+#include "hermitepolynomial.h"
 
 #include <string>
 #include <iostream>
@@ -48,17 +49,26 @@ namespace NAMESPACE {
 		// run
 		void RunOneUnresolved(void);
 		void RunFixedSpacingOneUnresolved(void);
+		void RunGaussHermiteOneUnresolved(void);
+		void RunSparseGrid(void);
+		void RunAdaptiveOneUnresolved(void);
+		void RunMonteCarlo(void);
+		void IntegrateNodes(const Array<double> &node, Array<double> &history);
+		void RunQuadrature(const Array<double> &node, const Array<double> &weight);
 
 		// Initialization
 		void Initialize(long numSystems = 1);
 		void SetInitialDataOneUnresolved(void);
 		void CheckDensity(void) const;
+		const Density &UnresolvedDensity(long j) const;
 		
 		// quadrature
 		void SetQuadratureType(std::string quadratureType);
+		void MakeSparseGrid(short level, Array<double> &node, Array<double> &weight) const;
 		
-		// averaging
-		void AverageOneUnresolved(void);
+		// averaging, the weighted sum of the resolved modes over the systems at output time n
+		void Average(long n, const Array<double> &weight);
+		void WriteAverage(long n);
 		
 		// member data
 	private:
@@ -67,6 +77,7 @@ namespace NAMESPACE {
 		double mQuadratureTolerance;
 		QuadratureType mQuadratureType;
 		short mQuadratureNumGridPoints;
+		short mSparseGridLevel;
 		
 		// averages
 		Matrix<double> mAverage;
@@ -80,6 +91,7 @@ namespace NAMESPACE {
 		mQuadratureTolerance = -1.0;
 		mQuadratureType = NO_QUADRATURE_TYPE;
 		mQuadratureNumGridPoints = 0;
+		mSparseGridLevel = DEFAULT_SPARSE_GRID_LEVEL;
 		
 		return;
 	} 
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _batchintegrator_h_
+#define _batchintegrator_h_
+
+#include "array.h"
+#include "opbeenums.h"
+#include "runcontrol.h"
+#include "opbeparameter.h"
+#include "stepcontrol.h"
+
+// evolves a batch of B Burgers systems (ensemble members) together. the modes are
+// stored modes x batch, y[(k - 1) B + b] = u_k of member b, so every loop in the
+// right hand side runs over the batch with unit stride and vectorizes however few
+// modes there are. all members share one adaptive Cash-Karp 4(5) step, controlled
+// by the worst member.
+
+namespace NAMESPACE {
+	class BatchIntegrator {
+	 public:
+        BatchIntegrator(void);
+		~BatchIntegrator(void) { };
+        
+		// copy constructor
+		BatchIntegrator(const BatchIntegrator &integrator);
+		
+		// initialize
+		void Initialize(const RunControl &runControl, const OPBEParameter &parameter, 
+						long numModes, long batchSize);
+		void Reset(void);
+		
+		// members, u is zero-based, i.e. u[k - 1] = u_k
+		void SetMember(long b, const double u[]);
+		void GetMember(long b, double u[]) const;
+		
+		// evolve all members from t to t1
+		void Evolve(double &t, double t1);
+		
+		// adaptive step size, shared by the members
+		double StepSize(void) const;
+		void SetStepSize(double h);
+		
+		// size
+		long NumModes(void) const;
+		long BatchSize(void) const;
+		
+	private:
+		void TimeDerivative(double t, const double u[], double uDot[]);
+		void TModel(double t, const double u[], double uDot[]);
+		void Step(double t, double h);
+		
+		// member data
+	private:
+		// equation
+		double mEpsilon;
+		bool mTModelOn;
+		long mNumModes;
+		long mBatchSize;
+		
+		// state and step workspace (numModes x batchSize)
+		Array<double> mY;
+		Array<double> mYNew;
+		Array<double> mYError;
+		Array<double> mYStage;
+		Array<double> mK[6];
+		Array<double> mWork;
+		
+		// step size
+		StepControl mStepControl;
+		double mStepSize;
+	};
+	
+	
+	
+	inline BatchIntegrator::BatchIntegrator()
+	{
+		mEpsilon = 0.0;
+		mTModelOn = false;
+		mNumModes = 0;
+		mBatchSize = 0;
+		mStepSize = DEFAULT_TIME_STEP;
+		
+		return;
+	} 
+	
+	
+	
+	inline void BatchIntegrator::Reset()
+	{
+		mStepSize = DEFAULT_TIME_STEP;
+		return;
+	}
+	
+	
+	
+	inline void BatchIntegrator::SetMember(long b, const double u[])
+	{
+		for (long i = 0; i < mNumModes; ++i)
+			mY[i * mBatchSize + b] = u[i];
+		
+		return;
+	}
+	
+	
+	
+	inline void BatchIntegrator::GetMember(long b, double u[]) const
+	{
+		for (long i = 0; i < mNumModes; ++i)
+			u[i] = mY[i * mBatchSize + b];
+		
+		return;
+	}
+	
+	
+	
+	inline double BatchIntegrator::StepSize() const
+	{
+		return mStepSize;
+	}
+	
+	
+	
+	inline void BatchIntegrator::SetStepSize(double h)
+	{
+		mStepSize = h;
+		return;
+	}
+	
+	
+	
+	inline long BatchIntegrator::NumModes() const
+	{
+		return mNumModes;
+	}
+	
+	
+	
+	inline long BatchIntegrator::BatchSize() const
+	{
+		return mBatchSize;
+	}
+}
+
+#endif // _batchintegrator_h_	
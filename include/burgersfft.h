@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _burgersfft_h_
+#define _burgersfft_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <gsl/gsl_fft_real.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+
+// pseudo-spectral evaluation of the quadratic sums in the Burgers Galerkin system.
+// the modes u_1, ..., u_N are placed on a grid of M >= 2N + 1 points (zero padded),
+// transformed, squared in "physical" space and transformed back. the padding plays
+// the role of the 2/3 rule, so the sums below are exact up to round-off:
+//
+// correlation(k) = sum_{p = 1}^{N - k} u_p u_{p + k},    k = 0, ..., N
+// convolution(n) = sum_{p + q = n} u_p u_q,              n = 0, ..., 2N
+//
+// and, for the t-model,
+//
+// work(j)      = sum_{p = j}^{N} (j + N - p) u_p u_{j + N - p} = (j + N) / 2 * convolution(j + N)
+// tmodelsum(m) = sum_{j = 1}^{m} work(j) u_{j + N - m}
+//
+// the last one is a correlation of work with u, so it reuses the transform of u
+// and the same gsl plans.
+
+namespace NAMESPACE {
+	class BurgersFFT {
+	 public:
+        BurgersFFT(void);
+		~BurgersFFT(void);
+
+		// copy constructor
+		BurgersFFT(const BurgersFFT &fft);
+
+		// initialize
+		void Initialize(long numModes);
+		void CleanUp(void);
+		bool Ready(void) const;
+
+		// sums, u is zero-based, i.e. u[k - 1] = u_k
+		void ComputeSums(const double u[]);
+		double Correlation(long k) const;
+		double Convolution(long n) const;
+		
+		// t-model sums, call ComputeSums with the same u first
+		void ComputeTModelSums(void);
+		double TModelSum(long m) const;
+
+		// size
+		long NumModes(void) const;
+		long GridSize(void) const;
+
+	private:
+		long GoodGridSize(long n) const;
+		void PowerSpectrum(const Array<double> &hc, Array<double> &power) const;
+		void Square(const Array<double> &hc, Array<double> &square) const;
+		void ConjugateProduct(const Array<double> &hc1, const Array<double> &hc2, Array<double> &product) const;
+
+		// member data
+	private:
+		long mNumModes;
+		long mGridSize;
+
+		// gsl plans
+		gsl_fft_real_wavetable *mpRealWavetable;
+		gsl_fft_halfcomplex_wavetable *mpHalfComplexWavetable;
+		gsl_fft_real_workspace *mpWorkspace;
+
+		// transform of the padded mode vector (halfcomplex storage)
+		Array<double> mSpectrum;
+
+		// results
+		Array<double> mCorrelation;
+		Array<double> mConvolution;
+		Array<double> mTModelSum;
+	};
+
+
+
+	inline BurgersFFT::BurgersFFT()
+	{
+		mNumModes = 0;
+		mGridSize = 0;
+
+		mpRealWavetable = NULL;
+		mpHalfComplexWavetable = NULL;
+		mpWorkspace = NULL;
+
+		return;
+	}
+
+
+
+	inline BurgersFFT::~BurgersFFT()
+	{
+		CleanUp();
+		return;
+	}
+
+
+
+	inline bool BurgersFFT::Ready() const
+	{
+		return mpWorkspace != NULL;
+	}
+
+
+
+	inline double BurgersFFT::Correlation(long k) const
+	{
+		return mCorrelation[k];
+	}
+
+
+
+	inline double BurgersFFT::Convolution(long n) const
+	{
+		return mConvolution[n];
+	}
+
+
+
+	inline double BurgersFFT::TModelSum(long m) const
+	{
+		return mTModelSum[mNumModes - m];
+	}
+
+
+
+	inline long BurgersFFT::NumModes() const
+	{
+		return mNumModes;
+	}
+
+
+
+	inline long BurgersFFT::GridSize() const
+	{
+		return mGridSize;
+	}
+}
+
+#endif // _burgersfft_h_
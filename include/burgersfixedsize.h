@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _burgersfixedsize_h_
+#define _burgersfixedsize_h_
+
+#include "namespace.h"
+
+// the Burgers right hand side (same as BurgersEquation in gsldriver.cpp) with the
+// number of modes and the t-model switch known at compile time, so that all loop
+// bounds are constants the compiler can unroll and vectorize. the reductions are
+// marked with omp simd, so compile with -fopenmp-simd (or -fopenmp) to let the
+// compiler reorder the sums.
+//
+// instantiations exist for the mode counts listed in burgersfixedsize.cpp;
+// FixedSizeBurgersEquation returns NULL for any other mode count.
+
+namespace NAMESPACE {
+	// u and uDot are zero-based, u[k - 1] = u_k
+	typedef void (*FixedSizeBurgersFunction)(double t, double epsilon, const double u[], double uDot[]);
+	
+	FixedSizeBurgersFunction FixedSizeBurgersEquation(long numModes, bool tModelOn);
+	
+	
+	
+	template <long N, bool TModelOn>
+	void BurgersEquationFixedSize(double t, double epsilon, const double u[], double uDot[])
+	{
+		for (long k = 1; k <= N; ++k) {
+			double sum1 = 0.0;
+			#pragma omp simd reduction(+:sum1)
+			for (long kp = 1; kp <= N - k; ++kp) 
+				sum1 += u[kp - 1] * u[kp + k - 1];
+			
+			double sum2 = 0.0;
+			#pragma omp simd reduction(+:sum2)
+			for (long kp = 1; kp <= k - 1; ++kp)
+				sum2 += kp * u[kp - 1] * u[k - kp - 1];
+			
+			uDot[k - 1] = -epsilon * k * k * u[k - 1] + 0.5 * (k * sum1 - sum2);
+		}
+		
+		if (TModelOn) {
+			double work[N + 1];
+			
+			for (long mpp = 1; mpp <= N; ++mpp) {
+				double sum = 0.0;
+				#pragma omp simd reduction(+:sum)
+				for (long mp = mpp; mp <= N; ++mp) 
+					sum += (mpp + N - mp) * u[mp - 1] * u[mpp + N - mp - 1];
+				
+				work[mpp] = sum;
+			}
+			
+			for (long m = 1; m <= N; ++m) {
+				double sum = 0.0;
+				#pragma omp simd reduction(+:sum)
+				for (long mpp = 1; mpp <= m; ++mpp) 
+					sum += work[mpp] * u[mpp + N - m - 1];
+				
+				uDot[m - 1] += -0.25 * t * m * sum;
+			}
+		}
+		
+		return;
+	}
+}
+
+#endif // _burgersfixedsize_h_
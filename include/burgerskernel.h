@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _burgerskernel_h_
+#define _burgerskernel_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <string>
+
+// direct evaluation of the sums in the Burgers Galerkin system, written so that
+// every inner loop is a dot product of two contiguous arrays. the modes are copied
+// into 1-based buffers (mU[k] = u_k) and the U(k - kp) terms are read from reversed
+// copies, so the dot product can be done with AVX2 or AVX-512 when the cpu has them.
+//
+// sum1(k)      = sum_{kp = 1}^{N - k} u_kp u_{kp + k}
+// sum2(k)      = sum_{kp = 1}^{k - 1} kp u_kp u_{k - kp}
+// work(j)      = sum_{p = j}^{N} (j + N - p) u_p u_{j + N - p}
+// tmodelsum(m) = sum_{j = 1}^{m} work(j) u_{j + N - m}
+
+namespace NAMESPACE {
+	enum KernelInstructionSet{SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL};
+
+	class BurgersKernel {
+	 public:
+        BurgersKernel(void);
+		~BurgersKernel(void) { };
+
+		// copy constructor
+		BurgersKernel(const BurgersKernel &kernel);
+
+		// initialize
+		void Initialize(long numModes);
+		void SetInstructionSet(KernelInstructionSet instructionSet);
+		KernelInstructionSet InstructionSet(void) const;
+		std::string InstructionSetName(void) const;
+
+		// sums, u is zero-based, i.e. u[k - 1] = u_k
+		void ComputeSums(const double u[]);
+		double Sum1(long k) const;
+		double Sum2(long k) const;
+
+		// t-model sums, call ComputeSums with the same u first
+		void ComputeTModelSums(void);
+		double TModelSum(long m) const;
+
+		// size
+		long NumModes(void) const;
+
+		// cpu
+		static KernelInstructionSet BestInstructionSet(void);
+
+	private:
+		typedef double (*DotProduct)(const double *x, const double *y, long n);
+
+		// member data
+	private:
+		long mNumModes;
+		KernelInstructionSet mInstructionSet;
+		DotProduct mpDotProduct;
+
+		// 1-based views of u and k u_k, and their reversed copies
+		Array<double> mU;
+		Array<double> mKU;
+		Array<double> mReversedU;
+		Array<double> mReversedKU;
+
+		// results (1-based)
+		Array<double> mSum1;
+		Array<double> mSum2;
+		Array<double> mWork;
+		Array<double> mTModelSum;
+	};
+
+
+
+	inline BurgersKernel::BurgersKernel()
+	{
+		mNumModes = 0;
+		mpDotProduct = NULL;
+		
+		SetInstructionSet(BestInstructionSet());
+
+		return;
+	}
+
+
+
+	inline KernelInstructionSet BurgersKernel::InstructionSet() const
+	{
+		return mInstructionSet;
+	}
+
+
+
+	inline double BurgersKernel::Sum1(long k) const
+	{
+		return mSum1[k];
+	}
+
+
+
+	inline double BurgersKernel::Sum2(long k) const
+	{
+		return mSum2[k];
+	}
+
+
+
+	inline double BurgersKernel::TModelSum(long m) const
+	{
+		return mTModelSum[m];
+	}
+
+
+
+	inline long BurgersKernel::NumModes() const
+	{
+		return mNumModes;
+	}
+}
+
+#endif // _burgerskernel_h_
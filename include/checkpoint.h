@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _checkpoint_h_
+#define _checkpoint_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <string>
+#include <vector>
+
+#include <gsl/gsl_rng.h>
+
+// state for restarting a run. a checkpoint is built in memory with the Write functions,
+// in whatever order the owner likes, and read back in the same order. Save writes it to
+// fileName.tmp, flushes that to disk and renames it over fileName, so a crash leaves
+// either the previous checkpoint or the new one, never a partial file. the layout is
+//
+// "OPBECKP", version, byte order mark, payload bytes, payload, checksum (fnv-1a) of the payload
+
+namespace NAMESPACE {
+	class Checkpoint {
+	 public:
+        Checkpoint(void);
+		~Checkpoint(void) { };
+		
+		// copy constructor
+		Checkpoint(const Checkpoint &checkpoint);
+		
+		// write
+		void Clear(void);
+		void WriteInteger(long long value);
+		void WriteDouble(double value);
+		void WriteArray(const Array<double> &value);
+		void WriteBytes(const void *data, long numBytes);
+		void WriteRandomNumberGenerator(const gsl_rng *pRNG);
+		void Save(const std::string &fileName) const;
+		
+		// read
+		void Load(const std::string &fileName);
+		long long ReadInteger(void);
+		double ReadDouble(void);
+		void ReadArray(Array<double> &value);
+		void ReadBytes(void *data, long numBytes);
+		void ReadRandomNumberGenerator(gsl_rng *pRNG);
+		bool AtEnd(void) const;
+		
+	private:
+		unsigned long long Checksum(void) const;
+		
+		// member data
+	private:
+		std::vector<char> mData;
+		long mPosition;
+	};
+	
+	
+	
+	inline Checkpoint::Checkpoint()
+	{
+		mPosition = 0;
+		return;
+	} 
+	
+	
+	
+	inline bool Checkpoint::AtEnd() const
+	{
+		return mPosition == (long) mData.size();
+	}
+}
+
+#endif // _checkpoint_h_
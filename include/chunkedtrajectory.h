@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _chunkedtrajectory_h_
+#define _chunkedtrajectory_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+// chunked, compressed mode history for large ensembles, a (time, system, mode) cube of
+// float64 cut into chunks of timesPerChunk output times, all systems and modesPerChunk
+// modes. the writer holds one block of output times in memory, so appending an output
+// time is a copy, and writes a block's chunks when it is full. inside a chunk the values
+// are stored mode major, [mode][time][system], so reading one mode for all times and
+// systems decompresses only the chunks of that mode.
+//
+// the chunks are byte shuffled (as the HDF5 shuffle filter) and compressed with zstd
+// when OPBE_HAVE_ZSTD is defined, else with lz4 when OPBE_HAVE_LZ4 is defined, else
+// stored as they are. the layout is
+//
+// header   "OPBECHK", version, byte order mark, bytes per value, codec, numModes,
+//          numSystems, numTimes (of the schedule), timesPerChunk, modesPerChunk, time[numTimes]
+// chunks   "CHNK" tag, codec, first time, number of times, first mode, number of modes,
+//          raw bytes, stored bytes, data
+// index    first time, number of times, first mode, number of modes and offset per chunk
+// trailer  number of chunks, offset of the index, number of times written, "OPBEIDX"
+//
+// the chunk headers repeat the index, so the reader can rebuild it by scanning the
+// chunks when a run stopped before writing the index.
+
+namespace NAMESPACE {
+	enum ChunkCodec{NO_CHUNK_CODEC, ZSTD_CHUNK_CODEC, LZ4_CHUNK_CODEC};
+	
+	struct ChunkIndexEntry {
+		long long mFirstTime;
+		long long mNumTimes;
+		long long mFirstMode;
+		long long mNumModes;
+		long long mOffset;
+	};
+	
+	
+	
+	class ChunkedTrajectoryWriter {
+	 public:
+        ChunkedTrajectoryWriter(void);
+		~ChunkedTrajectoryWriter(void);
+		
+		// copy constructor
+		ChunkedTrajectoryWriter(const ChunkedTrajectoryWriter &writer);
+		
+		// open and close, Close writes the last (partial) block of times and the index.
+		// Resume continues a file after its first numTimesWritten output times, which
+		// have to end a block, and cuts off the chunks and index past them
+		void Open(const std::string &fileName, long numModes, long numSystems, const Array<double> &time);
+		void Resume(const std::string &fileName, long numModes, long numSystems, 
+					const Array<double> &time, long numTimesWritten);
+		void Close(void);
+		bool IsOpen(void) const;
+		
+		// one record, the systems of each output time in order
+		void Write(const double mode[]);
+		
+		// writes the times in the block as a (short) block of their own
+		void Flush(void);
+		
+		// codec used for new chunks
+		static ChunkCodec BestCodec(void);
+		
+	private:
+		void AllocateBlock(void);
+		void WriteBlock(void);
+		
+		// member data
+	private:
+		std::ofstream mFile;
+		long mNumModes;
+		long mNumSystems;
+		long mTimesPerChunk;
+		long mModesPerChunk;
+		ChunkCodec mCodec;
+		
+		// the block of output times being filled, [time][system][mode]
+		Array<double> mBlock;
+		long mBlockFirstTime;
+		long mNumRecordsInBlock;
+		long mNumTimesWritten;
+		
+		// chunk scratch space
+		Array<double> mRaw;
+		Array<char> mShuffled;
+		Array<char> mStored;
+		
+		std::vector<ChunkIndexEntry> mIndex;
+	};
+	
+	
+	
+	class ChunkedTrajectoryReader {
+	 public:
+        ChunkedTrajectoryReader(void);
+		~ChunkedTrajectoryReader(void) { };
+		
+		// copy constructor
+		ChunkedTrajectoryReader(const ChunkedTrajectoryReader &reader);
+		
+		// open and close
+		void Open(const std::string &fileName);
+		void Close(void);
+		
+		// header
+		long NumModes(void) const;
+		long NumSystems(void) const;
+		long NumTimes(void) const;
+		double Time(long n) const;
+		
+		// output times in the file
+		long NumTimesWritten(void) const;
+		
+		// one mode for all times written and all systems, value[n numSystems + s]
+		void ReadMode(long mode, Array<double> &value);
+		
+		// modes of a system at output time n
+		void Read(long n, long system, Array<double> &mode);
+		
+	private:
+		void ReadIndex(void);
+		void ScanChunks(void);
+		void LoadChunk(long chunk);
+		
+		// member data
+	private:
+		std::ifstream mFile;
+		long mNumModes;
+		long mNumSystems;
+		long mNumTimes;
+		long mTimesPerChunk;
+		long mModesPerChunk;
+		Array<double> mTime;
+		long long mDataOffset;
+		long long mFileSize;
+		
+		std::vector<ChunkIndexEntry> mIndex;
+		long mNumTimesWritten;
+		
+		// the last chunk read, [mode][time][system]
+		long mLoadedChunk;
+		Array<double> mRaw;
+		Array<char> mShuffled;
+		Array<char> mStored;
+	};
+	
+	
+	
+	inline ChunkedTrajectoryWriter::ChunkedTrajectoryWriter()
+	{
+		mNumModes = 0;
+		mNumSystems = 0;
+		mTimesPerChunk = 0;
+		mModesPerChunk = 0;
+		mCodec = NO_CHUNK_CODEC;
+		mBlockFirstTime = 0;
+		mNumRecordsInBlock = 0;
+		mNumTimesWritten = 0;
+		
+		return;
+	}
+	
+	
+	
+	inline ChunkedTrajectoryWriter::~ChunkedTrajectoryWriter()
+	{
+		// a failed write can't be reported from a destructor (it would terminate), call
+		// Close to see it
+		try {
+			Close();
+		}
+		catch (...) {
+		}
+		
+		return;
+	}
+	
+	
+	
+	inline bool ChunkedTrajectoryWriter::IsOpen() const
+	{
+		return mFile.is_open();
+	}
+	
+	
+	
+	inline ChunkedTrajectoryReader::ChunkedTrajectoryReader()
+	{
+		mNumModes = 0;
+		mNumSystems = 0;
+		mNumTimes = 0;
+		mTimesPerChunk = 0;
+		mModesPerChunk = 0;
+		mDataOffset = 0;
+		mFileSize = 0;
+		mNumTimesWritten = 0;
+		mLoadedChunk = -1;
+		
+		return;
+	}
+	
+	
+	
+	inline long ChunkedTrajectoryReader::NumModes() const
+	{
+		return mNumModes;
+	}
+	
+	
+	
+	inline long ChunkedTrajectoryReader::NumSystems() const
+	{
+		return mNumSystems;
+	}
+	
+	
+	
+	inline long ChunkedTrajectoryReader::NumTimes() const
+	{
+		return mNumTimes;
+	}
+	
+	
+	
+	inline double ChunkedTrajectoryReader::Time(long n) const
+	{
+		return mTime[n];
+	}
+	
+	
+	
+	inline long ChunkedTrajectoryReader::NumTimesWritten() const
+	{
+		return mNumTimesWritten;
+	}
+}
+
+#endif // _chunkedtrajectory_h_
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _controlvariatestatistics_h_
+#define _controlvariatestatistics_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+#include "checkpoint.h"
+
+// running means and co-moments of a vector of samples f_i together with q controls
+// c_i1, ..., c_iq per entry, for the control variate estimate
+//
+// f_i - sum_c beta_ic (mean(c_ic) - E[c_ic])
+//
+// with the coefficients beta_i = Cov(c_i, c_i)^{-1} Cov(c_i, f_i) that minimize its variance.
+// the (q + 1) x (q + 1) co-moment matrix of (f_i, c_i) is updated one sample at a time
+// (Welford), and two accumulators are merged with
+//
+// C = CA + CB + (meanB - meanA) (meanB - meanA)^T nA nB / (nA + nB)
+//
+// (Chan et al.), so, as for RunningStatistics, merging in a fixed order gives the same result
+// however the samples were distributed.
+
+namespace NAMESPACE {
+	class ControlVariateStatistics {
+	 public:
+        ControlVariateStatistics(void);
+		~ControlVariateStatistics(void) { };
+		
+		// initialize
+		void Initialize(long size, long numControls);
+		void Reset(void);
+		
+		// accumulate, control[i q + c] is control c of entry i
+		void Add(const Array<double> &sample, const Array<double> &control);
+		void Merge(const ControlVariateStatistics &statistics);
+		
+		// restart
+		void WriteCheckpoint(Checkpoint &checkpoint) const;
+		void ReadCheckpoint(Checkpoint &checkpoint);
+		
+		// results, controlMean holds the q exact means of the controls of entry i
+		long Count(void) const;
+		long Size(void) const;
+		long NumControls(void) const;
+		double Mean(long i) const;
+		double Variance(long i) const;
+		void Means(Array<double> &mean) const;
+		void Coefficients(long i, Array<double> &beta) const;
+		double Estimate(long i, const double controlMean[]) const;
+		double VarianceRatio(long i) const;
+		double StandardError(long i) const;
+		
+		// member data
+	private:
+		long mCount;
+		long mSize;
+		long mNumControls;
+		
+		// per entry, the means of (f, c_1, ..., c_q) and their co-moment matrix
+		Array<double> mMean;
+		Array<double> mComoment;
+	};
+	
+	
+	
+	inline ControlVariateStatistics::ControlVariateStatistics()
+	{
+		mCount = 0;
+		mSize = 0;
+		mNumControls = 0;
+		
+		return;
+	} 
+	
+	
+	
+	inline long ControlVariateStatistics::Count() const
+	{
+		return mCount;
+	}
+	
+	
+	
+	inline long ControlVariateStatistics::Size() const
+	{
+		return mSize;
+	}
+	
+	
+	
+	inline long ControlVariateStatistics::NumControls() const
+	{
+		return mNumControls;
+	}
+	
+	
+	
+	inline double ControlVariateStatistics::Mean(long i) const
+	{
+		return mMean[i * (mNumControls + 1)];
+	}
+	
+	
+	
+	inline double ControlVariateStatistics::Variance(long i) const
+	{
+		// sample variance of f_i, without the controls
+		if (mCount < 2)
+			return 0.0;
+		
+		long m = mNumControls + 1;
+		return mComoment[i * m * m] / (mCount - 1);
+	}
+}
+
+#endif // _controlvariatestatistics_h_	
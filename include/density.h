@@ -43,6 +43,10 @@ namespace NAMESPACE {
 		void DomainBounds(double epsilon, double &min, double &max) const;
 		void OneDGaussianDomain(double epsilon, double &min, double &max) const;
 		
+		// sampling, u is in (0, 1)
+		double InverseCDF(double u) const;
+		double OneDGaussianInverseCDF(double u) const;
+		
 		// type
 		void SetType(DensityType type);
 		void SetType(const std::string &name);
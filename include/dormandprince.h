@@ -0,0 +1,380 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _dormandprince_h_
+#define _dormandprince_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+#include "stepcontrol.h"
+
+// Dormand-Prince 5(4) with the first same as last property: the last stage of an
+// accepted step is f(t + h, y_new), which is the first stage of the next step, so
+// an accepted step costs six right hand side evaluations. all stages are allocated
+// in Initialize, so a step does no allocation. Function is a functor with
+//
+// void operator()(double t, const double u[], double uDot[])
+//
+// which is called directly (and can be inlined), instead of through a void * callback.
+// step size control is the same as gsl_odeiv_control_y_new.
+
+namespace NAMESPACE {
+	template <class Function>
+	class DormandPrince {
+	 public:
+        DormandPrince(void);
+		~DormandPrince(void) { };
+		
+		// initialize
+		void Initialize(const Function &function, long size, double absoluteError, double relativeError);
+		void Reset(void);
+		
+		// evolve y from t to t1, h is the suggested step size, updated on return
+		void Evolve(double &t, double t1, double &h, double y[]);
+		
+		// one accepted step from t, not past t1
+		void TakeStep(double &t, double t1, double &h, double y[]);
+		
+		// dense output, after a step Derivative is f(t, y) at the new t and y, and
+		// DenseCorrection the fourth order term of the continuous extension
+		void SetDenseOutput(bool denseOutput);
+		const Array<double> &Derivative(void) const;
+		const Array<double> &DenseCorrection(void) const;
+		
+		// right hand side evaluations since Initialize
+		long NumEvaluations(void) const;
+		
+	private:
+		void CheckFirstStage(double t, const double y[]);
+		void AcceptedStep(double &t, double t1, double &h, double y[]);
+		void Step(double t, double h, const double y[]);
+		
+		// member data
+	private:
+		Function mFunction;
+		long mSize;
+		
+		// stages, mK[0] holds f(t, y) at the start of the step
+		Array<double> mK[7];
+		Array<double> mYStage;
+		Array<double> mYNew;
+		Array<double> mYError;
+		
+		// first same as last, valid when mK[0] = f(mT, mY)
+		bool mFirstStageValid;
+		double mT;
+		Array<double> mY;
+		
+		StepControl mStepControl;
+		long mNumEvaluations;
+		
+		// dense output
+		bool mDenseOutput;
+		Array<double> mDenseCorrection;
+		
+		// coefficients
+		static const double mC[7];
+		static const double mA[7][6];
+		static const double mE[7];
+		static const double mD[7];
+	};
+	
+	
+	
+	template <class Function>
+	const double DormandPrince<Function>::mC[7] = {0.0, 1.0 / 5.0, 3.0 / 10.0, 4.0 / 5.0, 8.0 / 9.0, 1.0, 1.0};
+	
+	// the last row is also the fifth order solution
+	template <class Function>
+	const double DormandPrince<Function>::mA[7][6] = {
+		{0.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+		{1.0 / 5.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+		{3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0, 0.0},
+		{44.0 / 45.0, -56.0 / 15.0, 32.0 / 9.0, 0.0, 0.0, 0.0},
+		{19372.0 / 6561.0, -25360.0 / 2187.0, 64448.0 / 6561.0, -212.0 / 729.0, 0.0, 0.0},
+		{9017.0 / 3168.0, -355.0 / 33.0, 46732.0 / 5247.0, 49.0 / 176.0, -5103.0 / 18656.0, 0.0},
+		{35.0 / 384.0, 0.0, 500.0 / 1113.0, 125.0 / 192.0, -2187.0 / 6784.0, 11.0 / 84.0}
+	};
+	
+	// fifth minus fourth order weights
+	template <class Function>
+	const double DormandPrince<Function>::mE[7] = {71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, 
+												   -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0};
+	
+	// dense output (Hairer, Norsett and Wanner), y(t + theta h) is the cubic Hermite interpolant
+	// plus theta^2 (1 - theta)^2 h sum_s mD[s] k_s
+	template <class Function>
+	const double DormandPrince<Function>::mD[7] = {-12715105075.0 / 11282082432.0, 0.0, 87487479700.0 / 32700410799.0,
+												   -10690763975.0 / 1880347072.0, 701980252875.0 / 199316789632.0,
+												   -1453857185.0 / 822651844.0, 69997945.0 / 29380423.0};
+	
+	
+	
+	template <class Function>
+	inline DormandPrince<Function>::DormandPrince()
+	{
+		mSize = 0;
+		mFirstStageValid = false;
+		mT = 0.0;
+		mNumEvaluations = 0;
+		mDenseOutput = false;
+		
+		return;
+	} 
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::Initialize(const Function &function, long size, double absoluteError, double relativeError)
+	{
+		if (size <= 0)
+			ThrowException("DormandPrince::Initialize : non-positive size");
+		
+		mFunction = function;
+		mSize = size;
+		
+		for (short s = 0; s < 7; ++s)
+			mK[s].SetSize(size);
+		
+		mYStage.SetSize(size);
+		mYNew.SetSize(size);
+		mYError.SetSize(size);
+		mY.SetSize(size);
+		mDenseCorrection.SetSize(size);
+		
+		// order 5, as gsl uses for its fifth order pairs
+		mStepControl.Initialize(absoluteError, relativeError, 5);
+		mNumEvaluations = 0;
+		
+		Reset();
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline void DormandPrince<Function>::Reset()
+	{
+		mFirstStageValid = false;
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline void DormandPrince<Function>::SetDenseOutput(bool denseOutput)
+	{
+		mDenseOutput = denseOutput;
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline const Array<double> &DormandPrince<Function>::Derivative() const
+	{
+		return mK[0];
+	}
+	
+	
+	
+	template <class Function>
+	inline const Array<double> &DormandPrince<Function>::DenseCorrection() const
+	{
+		return mDenseCorrection;
+	}
+	
+	
+	
+	template <class Function>
+	inline long DormandPrince<Function>::NumEvaluations() const
+	{
+		return mNumEvaluations;
+	}
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::Evolve(double &t, double t1, double &h, double y[])
+	{
+		CheckFirstStage(t, y);
+		
+		while (t < t1)
+			AcceptedStep(t, t1, h, y);
+		
+		mT = t;
+		for (long i = 0; i < mSize; ++i)
+			mY[i] = y[i];
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::TakeStep(double &t, double t1, double &h, double y[])
+	{
+		CheckFirstStage(t, y);
+		
+		if (t < t1)
+			AcceptedStep(t, t1, h, y);
+		
+		mT = t;
+		for (long i = 0; i < mSize; ++i)
+			mY[i] = y[i];
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::CheckFirstStage(double t, const double y[])
+	{
+		// the first stage from the last call can be reused if nobody changed y or t since
+		if (mFirstStageValid) {
+			if (t != mT)
+				mFirstStageValid = false;
+			
+			for (long i = 0; i < mSize && mFirstStageValid; ++i) {
+				if (y[i] != mY[i])
+					mFirstStageValid = false;
+			}
+		}
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::AcceptedStep(double &t, double t1, double &h, double y[])
+	{
+		if (mFirstStageValid == false) {
+			mFunction(t, y, mK[0].Begin());
+			++mNumEvaluations;
+			mFirstStageValid = true;
+		}
+		
+		double hStep = h;
+		bool finalStep = false;
+		
+		if (t + hStep >= t1) {
+			hStep = t1 - t;
+			finalStep = true;
+		}
+		
+		StepAdjustment adjustment;
+		double hNew;
+		
+		while (true) {
+			Step(t, hStep, y);
+			
+			hNew = hStep;
+			double errorRatio = mStepControl.ErrorRatio(mYNew.Begin(), mYError.Begin(), mSize);
+			adjustment = mStepControl.AdjustStepSize(errorRatio, hNew);
+			
+			if (adjustment != STEP_DECREASE)
+				break;
+			
+			// rejected, y and the first stage are unchanged
+			if (t + hNew == t)
+				ThrowException("DormandPrince::Evolve : step size underflow");
+			
+			hStep = hNew;
+			finalStep = false;
+		}
+		
+		if (mDenseOutput) {
+			// the part of the continuous extension beyond the cubic Hermite interpolant
+			for (long i = 0; i < mSize; ++i) {
+				double sum = 0.0;
+				for (short s = 0; s < 7; ++s)
+					sum += mD[s] * mK[s][i];
+				
+				mDenseCorrection[i] = hStep * sum;
+			}
+		}
+		
+		for (long i = 0; i < mSize; ++i)
+			y[i] = mYNew[i];
+		
+		if (finalStep)
+			t = t1;
+		else
+			t += hStep;
+		
+		// first same as last
+		for (long i = 0; i < mSize; ++i)
+			mK[0][i] = mK[6][i];
+		
+		// a step shortened to land on t1 doesn't shrink the next step
+		if (finalStep == false || hNew > h)
+			h = hNew;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void DormandPrince<Function>::Step(double t, double h, const double y[])
+	{
+		// stages 2, ..., 7, the last one at the new solution
+		for (short s = 1; s < 7; ++s) {
+			double *yStage = (s == 6) ? mYNew.Begin() : mYStage.Begin();
+			
+			for (long i = 0; i < mSize; ++i)
+				yStage[i] = y[i];
+			
+			for (short j = 0; j < s; ++j) {
+				double a = h * mA[s][j];
+				if (a == 0.0)
+					continue;
+				
+				const double *k = mK[j].Begin();
+				for (long i = 0; i < mSize; ++i)
+					yStage[i] += a * k[i];
+			}
+			
+			mFunction(t + mC[s] * h, yStage, mK[s].Begin());
+			++mNumEvaluations;
+		}
+		
+		double *yError = mYError.Begin();
+		for (long i = 0; i < mSize; ++i)
+			yError[i] = 0.0;
+		
+		for (short s = 0; s < 7; ++s) {
+			double e = h * mE[s];
+			if (e == 0.0)
+				continue;
+			
+			const double *k = mK[s].Begin();
+			for (long i = 0; i < mSize; ++i)
+				yError[i] += e * k[i];
+		}
+		
+		return;
+	}
+}
+
+#endif // _dormandprince_h_	
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _etdrk4_h_
+#define _etdrk4_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <math.h>
+
+// fourth order exponential time differencing Runge-Kutta (Cox and Matthews) for
+// u' = L u + N(u, t) with L diagonal. the linear part is integrated exactly, so the
+// step is limited by the nonlinear term and not by the largest |L_i|. with z = h L_i
+// and the phi functions
+//
+// phi1(z) = (e^z - 1) / z, phi2(z) = (e^z - 1 - z) / z^2, phi3(z) = (e^z - 1 - z - z^2 / 2) / z^3
+//
+// a step is
+//
+// a     = e^{z/2} u + Q N(u, t),                  Q = (h / 2) phi1(z / 2)
+// b     = e^{z/2} u + Q N(a, t + h / 2)
+// c     = e^{z/2} a + Q (2 N(b, t + h / 2) - N(u, t))
+// u_new = e^z u + f1 N(u, t) + 2 f2 (N(a) + N(b)) + f3 N(c, t + h)
+//
+// with f1 = h (phi1 - 3 phi2 + 4 phi3), f2 = h (phi2 - 2 phi3), f3 = h (4 phi3 - phi2).
+// the coefficients are computed once per step size, from the Taylor series when |z| < 1
+// to avoid the cancellation in the closed forms. Function is a functor for N with
+//
+// void operator()(double t, const double u[], double uDot[])
+
+namespace NAMESPACE {
+	template <class Function>
+	class ETDRK4 {
+	 public:
+        ETDRK4(void);
+		~ETDRK4(void) { };
+		
+		// initialize, linear is the diagonal of L
+		void Initialize(const Function &function, const Array<double> &linear, double timeStep);
+		
+		// evolve y from t to t1 with equal steps of at most the time step
+		void Evolve(double &t, double t1, double y[]);
+		
+		// right hand side evaluations since Initialize
+		long NumEvaluations(void) const;
+		
+	private:
+		void SetCoefficients(double h);
+		void Step(double t, double h, double y[]);
+		static void PhiFunctions(double z, double &phi1, double &phi2, double &phi3);
+		
+		// member data
+	private:
+		Function mFunction;
+		long mSize;
+		double mTimeStep;
+		long mNumEvaluations;
+		
+		// linear part and the coefficients for step size mCoefficientStep
+		Array<double> mLinear;
+		double mCoefficientStep;
+		Array<double> mE;
+		Array<double> mE2;
+		Array<double> mQ;
+		Array<double> mF1;
+		Array<double> mF2;
+		Array<double> mF3;
+		
+		// stages
+		Array<double> mA;
+		Array<double> mB;
+		Array<double> mC;
+		Array<double> mNu;
+		Array<double> mNa;
+		Array<double> mNb;
+		Array<double> mNc;
+	};
+	
+	
+	
+	template <class Function>
+	inline ETDRK4<Function>::ETDRK4()
+	{
+		mSize = 0;
+		mTimeStep = 0.0;
+		mNumEvaluations = 0;
+		mCoefficientStep = 0.0;
+		
+		return;
+	} 
+	
+	
+	
+	template <class Function>
+	void ETDRK4<Function>::Initialize(const Function &function, const Array<double> &linear, double timeStep)
+	{
+		if (linear.Size() <= 0)
+			ThrowException("ETDRK4::Initialize : empty linear part");
+		
+		if (timeStep <= 0.0)
+			ThrowException("ETDRK4::Initialize : non-positive time step");
+		
+		mFunction = function;
+		mSize = linear.Size();
+		mTimeStep = timeStep;
+		mNumEvaluations = 0;
+		
+		mLinear = linear;
+		
+		mE.SetSize(mSize);
+		mE2.SetSize(mSize);
+		mQ.SetSize(mSize);
+		mF1.SetSize(mSize);
+		mF2.SetSize(mSize);
+		mF3.SetSize(mSize);
+		
+		mA.SetSize(mSize);
+		mB.SetSize(mSize);
+		mC.SetSize(mSize);
+		mNu.SetSize(mSize);
+		mNa.SetSize(mSize);
+		mNb.SetSize(mSize);
+		mNc.SetSize(mSize);
+		
+		SetCoefficients(timeStep);
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline long ETDRK4<Function>::NumEvaluations() const
+	{
+		return mNumEvaluations;
+	}
+	
+	
+	
+	template <class Function>
+	void ETDRK4<Function>::PhiFunctions(double z, double &phi1, double &phi2, double &phi3)
+	{
+		if (fabs(z) < 1.0) {
+			// phi_j(z) = sum_n z^n / (n + j)!, 20 terms is below round-off for |z| < 1
+			phi1 = phi2 = phi3 = 0.0;
+			
+			double term = 1.0;
+			for (short n = 0; n < 20; ++n) {
+				// term = z^n / n!
+				phi1 += term / (n + 1.0);
+				phi2 += term / ((n + 1.0) * (n + 2.0));
+				phi3 += term / ((n + 1.0) * (n + 2.0) * (n + 3.0));
+				term *= z / (n + 1.0);
+			}
+			
+			return;
+		}
+		
+		double ez = exp(z);
+		phi1 = (ez - 1.0) / z;
+		phi2 = (ez - 1.0 - z) / (z * z);
+		phi3 = (ez - 1.0 - z - 0.5 * z * z) / (z * z * z);
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void ETDRK4<Function>::SetCoefficients(double h)
+	{
+		double phi1, phi2, phi3, halfPhi1, dum2, dum3;
+		
+		for (long i = 0; i < mSize; ++i) {
+			double z = h * mLinear[i];
+			
+			PhiFunctions(z, phi1, phi2, phi3);
+			PhiFunctions(0.5 * z, halfPhi1, dum2, dum3);
+			
+			mE[i] = exp(z);
+			mE2[i] = exp(0.5 * z);
+			mQ[i] = 0.5 * h * halfPhi1;
+			
+			mF1[i] = h * (phi1 - 3.0 * phi2 + 4.0 * phi3);
+			mF2[i] = h * (phi2 - 2.0 * phi3);
+			mF3[i] = h * (4.0 * phi3 - phi2);
+		}
+		
+		mCoefficientStep = h;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void ETDRK4<Function>::Evolve(double &t, double t1, double y[])
+	{
+		if (t1 <= t)
+			return;
+		
+		// equal steps so the last one lands on t1, the small tolerance keeps an interval that
+		// is a multiple of the time step (up to round-off) from getting an extra step
+		long numSteps = (long) ceil((t1 - t) / mTimeStep - 1.0e-9);
+		if (numSteps < 1)
+			numSteps = 1;
+		
+		double h = (t1 - t) / numSteps;
+		if (h != mCoefficientStep)
+			SetCoefficients(h);
+		
+		double t0 = t;
+		for (long n = 0; n < numSteps; ++n)
+			Step(t0 + n * h, h, y);
+		
+		t = t1;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void ETDRK4<Function>::Step(double t, double h, double y[])
+	{
+		mFunction(t, y, mNu.Begin());
+		
+		for (long i = 0; i < mSize; ++i)
+			mA[i] = mE2[i] * y[i] + mQ[i] * mNu[i];
+		
+		mFunction(t + 0.5 * h, mA.Begin(), mNa.Begin());
+		
+		for (long i = 0; i < mSize; ++i)
+			mB[i] = mE2[i] * y[i] + mQ[i] * mNa[i];
+		
+		mFunction(t + 0.5 * h, mB.Begin(), mNb.Begin());
+		
+		for (long i = 0; i < mSize; ++i)
+			mC[i] = mE2[i] * mA[i] + mQ[i] * (2.0 * mNb[i] - mNu[i]);
+		
+		mFunction(t + h, mC.Begin(), mNc.Begin());
+		
+		mNumEvaluations += 4;
+		
+		for (long i = 0; i < mSize; ++i)
+			y[i] = mE[i] * y[i] + mF1[i] * mNu[i] + 2.0 * mF2[i] * (mNa[i] + mNb[i]) + mF3[i] * mNc[i];
+		
+		return;
+	}
+}
+
+#endif // _etdrk4_h_	
@@ -33,6 +33,9 @@ namespace NAMESPACE {
 		
         // run
         void Run(const std::string &fileName);
+		
+		// test
+		void Test(const std::string &fileName);
 				
 	private:
 		// input
@@ -40,6 +43,10 @@ namespace NAMESPACE {
 		
 		// initialization
 		void Initialize(void);
+		
+		// test
+		void Benchmark(void);
+		void BenchmarkSolvers(void);
 	};
 }
 
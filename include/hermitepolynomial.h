@@ -47,6 +47,10 @@ namespace NAMESPACE {
 		// inner product
 		double InnerProduct(const Array<double> &f, const Array<double> &grid, short n) const;
 		
+		// gauss-hermite rule for the density, sum_i weight[i] f(node[i]) approximates the
+		// mean of f and is exact when f is a polynomial of degree < 2 numPoints
+		void GaussQuadrature(short numPoints, Array<double> &node, Array<double> &weight) const;
+		
 	private:
 		void ComputeNormalizationFactors(short numFactors);
 		double EvaluateStandard(double x, short n) const;
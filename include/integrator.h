@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _integrator_h_
+#define _integrator_h_
+
+#include "array.h"
+#include "opbeenums.h"
+#include "opbeconst.h"
+#include "runcontrol.h"
+#include "modeindex.h"
+#include "opbeparameter.h"
+#include "burgersfft.h"
+#include "burgerskernel.h"
+#include "burgersfixedsize.h"
+#include "dormandprince.h"
+#include "etdrk4.h"
+#include "sdirk2.h"
+#include "ark43.h"
+#include "checkpoint.h"
+
+#include <string>
+
+#include <gsl/gsl_odeiv.h>
+
+namespace NAMESPACE {
+	// everything the right hand side needs, including its scratch space, so that
+	// each Integrator (and so each System) can be evolved on its own thread
+	struct RHSParameters {
+		RHSParameters(void);
+		
+		double mEpsilon;
+		bool mTModelOn;
+		long mNumModes;
+		SystemType mSystemType;
+		RHSMethod mRHSMethod;
+		ModeIndex mModeIndex;
+		
+		// workspaces for the different right hand side methods
+		BurgersFFT mFFT;
+		BurgersKernel mKernel;
+		FixedSizeBurgersFunction mpFixedSize;
+		Array<double> mWork;
+		Array<double> mJacobianWork;
+	};
+	
+	// right hand side, defined in gsldriver.cpp
+	int TimeDerivative(double t, const double u[], double uDot[], void *params);
+	int BurgersEquation(double t, const double u[], double uDot[], RHSParameters *pParams);
+	int Jacobian(double t, const double u[], double *dfdy, double dfdt[], void *params);
+	void InitializeRHSWorkspace(RHSParameters &params);
+	
+	// Burgers right hand side for the native steppers, without the system type switch
+	// and void * parameters of TimeDerivative
+	struct BurgersFunction {
+		BurgersFunction(RHSParameters *pParams = NULL) : mpParameters(pParams) { };
+		
+		void operator()(double t, const double u[], double uDot[]) const
+		{
+			BurgersEquation(t, u, uDot, mpParameters);
+		}
+		
+		RHSParameters *mpParameters;
+	};
+	
+	
+	
+	class Integrator {
+	 public:
+        Integrator(void);
+		~Integrator(void);
+        
+		// copy constructor
+		Integrator(const Integrator &integrator);
+		
+		// initialize and clean up
+		void Initialize(const RunControl &runControl, const OPBEParameter &parameter, 
+						const ModeIndex &modeIndex, long numModes);
+		void CleanUp(void);
+		bool Initialized(void) const;
+		
+		// forget the step history, for starting a new trajectory
+		void Reset(void);
+		
+		// restart, the step size and the dense output state
+		void WriteCheckpoint(Checkpoint &checkpoint) const;
+		void ReadCheckpoint(Checkpoint &checkpoint);
+		
+		// evolve y from t to t1
+		void Evolve(double &t, double t1, double y[]);
+		
+		// adaptive step size
+		double StepSize(void) const;
+		void SetStepSize(double h);
+		
+		// right hand side
+		RHSParameters &Parameters(void);
+		
+	private:
+		void SetGSLStepType(const std::string &solverName);
+		void InitializeGSL(const RunControl &runControl, long numModes);
+		void InitializeDormandPrince(const RunControl &runControl, long numModes);
+		void InitializeETDRK4(const RunControl &runControl, long numModes);
+		void InitializeSDIRK2(const RunControl &runControl, long numModes);
+		void InitializeARK43(const RunControl &runControl, long numModes);
+		void GSLStep(double &t, double t1, double y[]);
+		
+		// dense output
+		void DenseEvolve(double &t, double t1, double y[]);
+		void StartDenseOutput(double t, const double y[]);
+		void TakeStep(double &t, double t1, double y[]);
+		void Derivative(double t, const double y[], double f[]);
+		
+		// member data
+	private:
+		// right hand side parameters and scratch space
+		RHSParameters mParameters;
+		
+		// which stepper
+		IntegratorType mType;
+		
+		// native steppers
+		DormandPrince<BurgersFunction> mDormandPrince;
+		ETDRK4<BurgersFunction> mETDRK4;
+		SDIRK2<BurgersFunction> mSDIRK2;
+		ARK43<BurgersFunction> mARK43;
+		
+		// gsl objects
+		const gsl_odeiv_step_type *mpStepType;
+		gsl_odeiv_step *mpStep;
+		gsl_odeiv_control *mpControl;
+		gsl_odeiv_evolve *mpEvolve;
+		
+		// adaptive step size, carried between calls to Evolve
+		double mStepSize;
+		
+		// linear part taken out of the right hand side (etdrk4 and ark43)
+		Array<double> mLinear;
+		double mTimeStep;
+		
+		// dense output, the step from mLeftTime to mRightTime is interpolated and
+		// (mOutputTime, mOutputY) is the last value handed back
+		bool mDenseOutput;
+		bool mDenseValid;
+		double mEndTime;
+		double mLeftTime;
+		double mRightTime;
+		double mOutputTime;
+		Array<double> mLeftY;
+		Array<double> mLeftF;
+		Array<double> mRightY;
+		Array<double> mRightF;
+		Array<double> mDenseCorrection;
+		Array<double> mOutputY;
+	};
+	
+	
+	
+	inline RHSParameters::RHSParameters()
+	{
+		mEpsilon = 0.0;
+		mTModelOn = false;
+		mNumModes = 0;
+		mSystemType = NO_SYSTEM_TYPE;
+		mRHSMethod = DIRECT_RHS;
+		mpFixedSize = NULL;
+		
+		return;
+	}
+
+
+
+	inline Integrator::Integrator()
+	{
+		mType = NO_INTEGRATOR_TYPE;
+		
+		mpStepType = NULL;
+		mpStep = NULL;
+		mpControl = NULL;
+		mpEvolve = NULL;
+		
+		mStepSize = DEFAULT_TIME_STEP;
+		mTimeStep = DEFAULT_TIME_STEP;
+		
+		mDenseOutput = false;
+		mDenseValid = false;
+		mEndTime = 0.0;
+		mLeftTime = 0.0;
+		mRightTime = 0.0;
+		mOutputTime = 0.0;
+		
+		return;
+	} 
+	
+	
+	
+	inline Integrator::~Integrator()
+	{
+		CleanUp();
+		return;
+	}
+	
+	
+	
+	inline bool Integrator::Initialized() const
+	{
+		return mType != NO_INTEGRATOR_TYPE;
+	}
+	
+	
+	
+	inline double Integrator::StepSize() const
+	{
+		return mStepSize;
+	}
+	
+	
+	
+	inline void Integrator::SetStepSize(double h)
+	{
+		mStepSize = h;
+		return;
+	}
+	
+	
+	
+	inline RHSParameters &Integrator::Parameters()
+	{
+		return mParameters;
+	}
+}
+
+#endif // _integrator_h_	
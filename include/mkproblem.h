@@ -23,12 +23,17 @@
 #include "problem.h"
 #include "realmatrix.h"
 #include "hermitepolynomial.h"
+#include "runningstatistics.h"
+#include "controlvariatestatistics.h"
 
 #include <string>
 #include <iostream>
 
 namespace NAMESPACE {
 	class MKProblem : public Problem {
+		friend class MonteCarloTask;
+		friend class MultilevelTask;
+		
 	 public:
         MKProblem(void);
 		~MKProblem(void) { };
@@ -45,40 +50,99 @@ namespace NAMESPACE {
 	private:
 		// run
 		void Run(void);
+		long BlockSize(void) const;
+		long RunsPerSample(void) const;
+		void RunBlock(long block, long worker, const double point[], ControlVariateStatistics &statistics);
+		void RunSerial(long numRuns, gsl_rng *pRNG, const double point[], System &system, 
+					   ControlVariateStatistics &statistics) const;
+		void RunBatch(long numRuns, gsl_rng *pRNG, const double point[], System &system, 
+					  BatchIntegrator &integrator, ControlVariateStatistics &statistics) const;
+		
+		// multilevel monte carlo
+		void RunMultilevel(void);
+		void RunLevel(long level, long numRuns);
+		void RunLevelBlock(long level, long block, long worker, ControlVariateStatistics &statistics);
+		void AllocateLevelRuns(double targetVariance, Array<long> &numRuns) const;
+		double LevelVariance(long level) const;
+		double EvolveSample(System &system, double weight, double sample[]) const;
+		void PrintLevels(void) const;
 		
 		// input
 		void ReadInputFile(const std::string &fileName);
 				
 		// Initialization
 		void Initialize(void);
+		void InitializeLevels(void);
 		
-		// initial data
-		void ComputeInitialData(void);
+		// initial data, from pRNG, or from the quasi-random point u when it isn't NULL
+		void ComputeInitialData(System &system, gsl_rng *pRNG, const double u[] = NULL) const;
+		void MirrorInitialData(System &system) const;
+		void ComputeQuasiRandomPoints(long firstBlock, long numBlocks);
 		
 		// density
 		void SetInitialDensities(void);
 		
-		// volterra equation
-		void UpdateVolterraCoefficients(long timeStep);
-		void UpdateVolterraFAverage(long timeStep);
-		
 		// averaging
-		double GaussianRandomVariable(double mean, double sigma) const;
-		void SetBigS(void);
+		double GaussianRandomVariable(gsl_rng *pRNG, double mean, double sigma) const;
+		double BigS(const System &system) const;
+		
+		// control variates, from the initial data only
+		void AccumulateControls(const System &system, double bigS, double weight, double control[]) const;
+		void ComputeControlMeans(void);
+		void PrintVarianceReduction(void) const;
+		
+		// standard error of mVolterraF0, returns the largest entry
+		double ComputeStandardError(void);
 		
 		// IO 
 		void WriteVolterraFFile(void);
+		void WriteVolterraMatrix(std::ofstream &fileStream, const Matrix<double> &matrix) const;
+		
+		// checkpoints
+		void WriteCheckpoint(Checkpoint &checkpoint) const;
+		void ReadCheckpoint(Checkpoint &checkpoint);
 
 		// member data
 	private:
-		// monte carlo
+		// monte carlo, with a target standard error mNumMonteCarloRuns is a cap
 		long mNumMonteCarloRuns;
-		long mRunCount;
+		double mTargetStandardError;
+		
+		// variance reduction, a sample is the mean of a run and its mirror image when
+		// antithetic, and carries mNumControls controls per entry with known means
+		bool mAntithetic;
+		long mNumControls;
+		Matrix<double> mDecay;
+		Array<double> mControlMean;
+		
+		// multilevel monte carlo, level l estimates the mean of f_l - f_(l-1) from runs with
+		// mLevelModes[l] modes at absolute error mLevelAbsoluteError[l], and a coarse run on the
+		// first mLevelModes[l - 1] modes of the same initial data. one System per level and thread.
+		// the cost per run of each level is mLevelCost when it is given, else the measured time
+		long mNumLevels;
+		long mNumPilotRuns;
+		Array<long> mLevelModes;
+		Array<double> mLevelAbsoluteError;
+		Array<ModeIndex> mLevelModeIndex;
+		Array<System> mLevelSystem;
+		Array<ControlVariateStatistics> mLevelStatistics;
+		Array<double> mLevelTime;
+		Array<double> mLevelCost;
+		
+		// quasi-random runs are in replicates of whole blocks, the points of a batch of
+		// blocks are made in order before the blocks run
+		long mRunsPerReplicate;
+		Array<double> mQuasiRandomPoint;
+		Array<RunningStatistics> mReplicateStatistics;
+		
+		// mean over all samples, and per block accumulators for one batch of blocks
+		ControlVariateStatistics mStatistics;
+		Array<ControlVariateStatistics> mBlockStatistics;
 		
 		// volterra equation
 		short mFiniteRankSize;
 		Matrix<double> mVolterraF0;
-		double mBigS;
+		Matrix<double> mVolterraF0Error;
 	};
 
 
@@ -86,8 +150,13 @@ namespace NAMESPACE {
 	inline MKProblem::MKProblem()
 	{
 		mNumMonteCarloRuns = 0;
+		mTargetStandardError = 0.0;
+		mRunsPerReplicate = 0;
+		mAntithetic = false;
+		mNumControls = 0;
+		mNumLevels = 1;
+		mNumPilotRuns = DEFAULT_MULTILEVEL_PILOT_RUNS;
 		mFiniteRankSize = 1;
-		mRunCount = 0;
 		
 		return;
 	} 
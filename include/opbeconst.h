@@ -31,14 +31,64 @@ namespace NAMESPACE {
 	const short DEFAULT_QUADRATURE_NUM_POINTS = 5;
 	const double HERMITE_INTEGRATION_MULTIPLIER = 1.1;
 	
+	// newton iteration for the gauss-hermite nodes
+	const short GAUSS_HERMITE_MAX_ITERATIONS = 20;
+	const double GAUSS_HERMITE_TOLERANCE = 3.0e-14;
+	
+	// smolyak sparse grids, nodes whose merged weight is below the cutoff relative to the
+	// sum of the magnitudes of the terms merged into it (so cancelled to round-off) are dropped
+	const short DEFAULT_SPARSE_GRID_LEVEL = 3;
+	const double SPARSE_GRID_WEIGHT_CUTOFF = 1.0e-14;
+	
+	// adaptive quadrature, panels aren't split below (domain width) / 2^level
+	const short ADAPTIVE_QUADRATURE_MAX_LEVEL = 20;
+	
+	// independently shifted copies of the quasi-random points, for the error estimate
+	const long DEFAULT_NUM_REPLICATES = 16;
+	
 	// gsl
 	const std::string DEFAULT_GSL_SOLVER = "rk8pd";
+	
+	// default solver when the viscous rate epsilon N^2 is above the threshold
+	const std::string DEFAULT_STIFF_SOLVER = "ark43";
+	const double STIFF_SOLVER_THRESHOLD = 1.0e3;
+	
 	const double DEFAULT_TIME_STEP = 1.0e-3;
 	const double DEFAULT_LOCAL_RELATIVE_ERROR = 0.0;
 	const double DEFAULT_LOCAL_ABSOLUTE_ERROR = 1.0e-6;
 	const std::string DEFAULT_GSL_RANDOM_NUMBER_GENERATOR = "taus";
 	const unsigned long int DEFAULT_RANDOM_SEED = 0;
 	
+	// newton-krylov (sdirk2), the newton tolerance is relative to the local error
+	const short NEWTON_MAX_ITERATIONS = 8;
+	const double NEWTON_TOLERANCE = 0.1;
+	const long GMRES_RESTART = 20;
+	const short GMRES_MAX_RESTARTS = 4;
+	const double GMRES_RELATIVE_TOLERANCE = 1.0e-3;
+	
+	// threads
+	const long DEFAULT_NUM_THREADS = 1;
+	
+	// monte carlo runs per random number stream, and blocks per thread between merges
+	const long MONTE_CARLO_BLOCK_SIZE = 16;
+	const long MONTE_CARLO_BLOCKS_PER_THREAD = 4;
+	
+	// control variates per entry in MKProblem (the t = 0 value and the linearised dynamics), a
+	// control whose pivot is below the tolerance (relative to the largest variance) gets no weight
+	const long MK_NUM_CONTROL_VARIATES = 2;
+	const double CONTROL_VARIATE_PIVOT_TOLERANCE = 1.0e-10;
+	
+	// multilevel monte carlo, runs per level before the variances and costs are estimated
+	const long DEFAULT_MULTILEVEL_PILOT_RUNS = 32;
+	
+	// runs until a target standard error, the cap when numberofruns isn't given and the runs
+	// before the first convergence check
+	const long DEFAULT_MAX_MONTE_CARLO_RUNS = 1000000;
+	const long MIN_SEQUENTIAL_RUNS = 32;
+	
+	// right hand side benchmark
+	const long RHS_BENCHMARK_NUM_EVALUATIONS = 1000;
+	
 	// numerical constants
 	const double ONE_OVER_SQRT_2PI = 1.0 / sqrt(2.0 * PI);
 	const double ONE_OVER_2PI = 1.0 / (2.0 * PI);
@@ -51,6 +101,21 @@ namespace NAMESPACE {
 	const double DEFAULT_FIRST_OUTPUT_TIME = 0.1;
 	const short DEFAULT_NUM_MOMENTS = 10;
 	
+	// binary mode files are written in blocks of this many bytes
+	const long TRAJECTORY_BUFFER_SIZE = 1 << 20;
+	
+	// chunked mode files, bytes of output times held by the writer, bytes per chunk and
+	// the zstd compression level
+	const long CHUNK_BLOCK_BUFFER_SIZE = 1 << 24;
+	const long CHUNK_SIZE = 1 << 18;
+	const int CHUNK_ZSTD_LEVEL = 3;
+	
+	// snapshots in flight between the integration and the output thread
+	const long OUTPUT_QUEUE_SIZE = 8;
+	
+	// seconds of wall clock time between checkpoints
+	const double DEFAULT_CHECKPOINT_INTERVAL = 600.0;
+	
 	// hermite polynomials
 	const short DEFAULT_FINITE_RANK_SIZE = 10;
 	const double HERMITE_DOMAIN_STEP = 0.1;
@@ -29,6 +29,13 @@ namespace OPBurgersEquation {
 	
 	enum SystemType{NO_SYSTEM_TYPE, BURGERS_EQUATION, NAVIER_STOKES};
 	
+	enum RHSMethod{NO_RHS_METHOD, DIRECT_RHS, FFT_RHS, SIMD_RHS};
+	enum ModeFileFormat{TEXT_MODE_FILE, BINARY_MODE_FILE, BINARY32_MODE_FILE, CHUNKED_MODE_FILE};
+	
+	enum IntegratorType{NO_INTEGRATOR_TYPE, GSL_INTEGRATOR, DOPRI5_INTEGRATOR, ETDRK4_INTEGRATOR, SDIRK2_INTEGRATOR, ARK43_INTEGRATOR};
+	
+	enum StepAdjustment{STEP_DECREASE, STEP_UNCHANGED, STEP_INCREASE};
+	
 	enum ModeType{RESOLVED_MODE, UNRESOLVED_MODE};
 	
 	enum ProblemType{NO_PROBLEM_TYPE, AVERAGING_PROBLEM, MK_PROBLEM, DELTA_PROBLEM, FIXED_IC_PROBLEM};
@@ -36,7 +43,11 @@ namespace OPBurgersEquation {
 	enum QuadratureType{NO_QUADRATURE_TYPE, 
 						FIXED_SPACING_QUADRATURE, 
 						ADAPTIVE_QUADRATURE, 
-						MONTE_CARLO_QUADRATURE};
+						MONTE_CARLO_QUADRATURE,
+						GAUSS_HERMITE_QUADRATURE,
+						SPARSE_GRID_QUADRATURE};
+	
+	enum SamplingType{PSEUDO_RANDOM_SAMPLING, QUASI_RANDOM_SAMPLING};
 	
 	enum OutputScheduleMode{NO_OUTPUT_SCHEDULE_MODE, 
 							OUTPUT_SCHEDULE_LINEAR, 
@@ -47,6 +58,8 @@ namespace OPBurgersEquation {
 							  MOMENTS_OUTPUT_STREAM,
 							  TMODEL_RATIO_OUTPUT_STREAM,
 							  VOLTERRA_F0_OUTPUT_STREAM,
+							  AVERAGE_OUTPUT_STREAM,
+							  VOLTERRA_F0_ERROR_OUTPUT_STREAM,
 							  END_OUTPUT_STREAM};
 }
 
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _outputpipeline_h_
+#define _outputpipeline_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+
+// moves output off the integration thread. the integration thread copies the modes
+// into a snapshot and publishes it, and a writer thread computes the diagnostics and
+// formats the output. the snapshots sit in a fixed ring of slots with one producer and
+// one consumer, handed over with two atomic counters (the mutex is only used to sleep
+// when the ring is empty or full). when the writer falls behind and the ring is full,
+// AcquireSlot waits, so at most numSlots snapshots are ever held in memory.
+//
+// an exception in the writer is rethrown on the integration thread by the next
+// Publish or by Finish.
+
+namespace NAMESPACE {
+	struct OutputSnapshot {
+		double mTime;
+		Array<double> mMode;
+	};
+	
+	
+	
+	class OutputPipeline {
+	 public:
+		typedef void (*ConsumeFunction)(const OutputSnapshot &snapshot, void *params);
+		
+        OutputPipeline(void);
+		~OutputPipeline(void);
+        
+		// copy constructor
+		OutputPipeline(const OutputPipeline &pipeline);
+		
+		// start the writer thread, which calls consume(snapshot, params) for each snapshot in order
+		void Initialize(ConsumeFunction consume, void *params, long numSlots, long snapshotSize);
+		bool Running(void) const;
+		
+		// producer side, fill the slot and publish it
+		OutputSnapshot &AcquireSlot(void);
+		void Publish(void);
+		
+		// wait for the published snapshots to be written, Drain leaves the writer thread
+		// running and Finish stops it. both rethrow a writer exception, CleanUp doesn't
+		void Drain(void);
+		void Finish(void);
+		void CleanUp(void);
+		
+	private:
+		void WaitUntilEmpty(void);
+		void WriterLoop(void);
+		void RethrowWriterException(void);
+		
+		// member data
+	private:
+		ConsumeFunction mConsume;
+		void *mpParams;
+		
+		Array<OutputSnapshot> mSlot;
+		std::atomic<unsigned long> mHead;
+		std::atomic<unsigned long> mTail;
+		
+		std::thread mThread;
+		bool mStop;
+		std::mutex mMutex;
+		std::condition_variable mNotEmpty;
+		std::condition_variable mNotFull;
+		
+		// first writer failure, later snapshots are dropped
+		std::atomic<bool> mFailed;
+		std::exception_ptr mException;
+	};
+	
+	
+	
+	inline OutputPipeline::OutputPipeline()
+	{
+		mConsume = NULL;
+		mpParams = NULL;
+		mHead = 0;
+		mTail = 0;
+		mStop = false;
+		mFailed = false;
+		
+		return;
+	}
+	
+	
+	
+	inline OutputPipeline::~OutputPipeline()
+	{
+		CleanUp();
+		return;
+	}
+	
+	
+	
+	inline bool OutputPipeline::Running() const
+	{
+		return mThread.joinable();
+	}
+}
+
+#endif // _outputpipeline_h_
@@ -27,14 +27,25 @@
 #include "density.h"
 #include "modeindex.h"
 #include "opbeparameter.h"
+#include "threadpool.h"
+#include "batchintegrator.h"
+#include "trajectoryfile.h"
+#include "chunkedtrajectory.h"
+#include "outputpipeline.h"
+#include "checkpoint.h"
+#include "quasirandom.h"
+#include "runningstatistics.h"
 
 #include <string>
 #include <iostream>
+#include <ctime>
 
 #include <gsl/gsl_rng.h>
 
 namespace NAMESPACE {
 	class Problem {
+		friend class EvolveBatchTask;
+		
 	 public:
         Problem(void);
 		~Problem(void) { };
@@ -51,18 +62,42 @@ namespace NAMESPACE {
 		void ReadInitialConditions(const std::string &fileName);
 		void Reset(void);
 		void InitializeRandomNumberGenerator(void);
+		gsl_rng *AllocateRandomNumberGenerator(void) const;
+		unsigned long int StreamSeed(unsigned long int stream) const;
+		void SetSamplingType(const std::string &samplingType);
+		
+		// the error of a mean estimated from independent replicates, per entry and the largest
+		double ReplicateStandardError(const Array<RunningStatistics> &replicate, Array<double> &error) const;
+		void PrintReplicateError(const Array<RunningStatistics> &replicate) const;
 		
 		// evolution
 		void Evolve(double t1);
+		void EvolveBatch(long batch, double t1);
+		void InitializeBatchIntegrators(void);
 		
-		// IO
+		// IO, the output at an output time is a snapshot of the modes of all systems,
+		// written here or on the output pipeline thread
 		void WriteOutput(void);
-		void WriteModes(void);
-		void WriteEnergy(void);
-		void WriteMoments(void);
-		void WriteTModelRatio(void);
+		void FinishOutput(void);
+		void WriteSnapshot(const OutputSnapshot &snapshot);
+		static void ConsumeSnapshot(const OutputSnapshot &snapshot, void *params);
+		void WriteModes(const OutputSnapshot &snapshot);
+		void WriteBinaryModes(const OutputSnapshot &snapshot);
+		void WriteEnergy(double t, const System &system);
+		void WriteMoments(double t, const System &system);
+		void WriteTModelRatio(double t, const System &system);
 		void PrintCurrentTime(void) const;
 		
+		// checkpoints, position is where the run continues from (an output time or a
+		// block of runs), RestoreCheckpoint returns 0 when there is no restart file. they
+		// are only taken there, a run with sparse output times can go well past the
+		// checkpoint interval between them
+		bool CheckpointDue(void) const;
+		void SaveCheckpoint(long position);
+		long RestoreCheckpoint(void);
+		virtual void WriteCheckpoint(Checkpoint &checkpoint) const;
+		virtual void ReadCheckpoint(Checkpoint &checkpoint);
+		
 		// member data
 	protected:
 		// run control parameters
@@ -88,6 +123,12 @@ namespace NAMESPACE {
 		// systems
 		Array<System> mSystem;
 		
+		// threads for evolving the systems
+		ThreadPool mThreadPool;
+		
+		// batched evolution, one integrator per batch of systems
+		Array<BatchIntegrator> mBatchIntegrator;
+		
 		// initial density
 		Array<Density> mInitialDensity;
 		
@@ -96,6 +137,30 @@ namespace NAMESPACE {
 		
 		// random number generator
 		gsl_rng *mpGSLRandomNumberGenerator;
+		
+		// sampling of the initial densities, quasi-random points come in replicates
+		SamplingType mSamplingType;
+		long mNumReplicates;
+		QuasiRandomSampler mQuasiRandomSampler;
+		
+		// binary mode file, a restarted run continues it after mNumOutputTimesWritten
+		std::string mModeFileName;
+		long mNumOutputTimesWritten;
+		TrajectoryWriter mTrajectoryWriter;
+		ChunkedTrajectoryWriter mChunkedWriter;
+		
+		// checkpoint and restart
+		std::string mCheckpointFileName;
+		std::string mRestartFileName;
+		double mCheckpointInterval;
+		time_t mLastCheckpointTime;
+		
+		// output, the snapshot for synchronous output, a system holding the modes of the
+		// first system for the diagnostics, and the pipeline for asynchronous output (last,
+		// so its thread is stopped before the rest is destroyed)
+		OutputSnapshot mSnapshot;
+		System mOutputSystem;
+		OutputPipeline mOutputPipeline;
 	};
 
 
@@ -111,6 +176,14 @@ namespace NAMESPACE {
 		
 		mpGSLRandomNumberGenerator = NULL;
 		
+		mSamplingType = PSEUDO_RANDOM_SAMPLING;
+		mNumReplicates = DEFAULT_NUM_REPLICATES;
+		
+		mNumOutputTimesWritten = 0;
+		
+		mCheckpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+		mLastCheckpointTime = time(NULL);
+		
 		return;
 	} 
 }
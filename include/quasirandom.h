@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _quasirandom_h_
+#define _quasirandom_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <string>
+
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_qrng.h>
+
+// randomized quasi-monte carlo points in the unit cube. the base sequence is sobol up to
+// the 40 dimensions gsl has direction numbers for, and halton above that. each replicate
+// is the base sequence with its own random shift, a digital (xor) shift of the 32 bit
+// binary digits for sobol, which keeps it a (t, s)-sequence, and a shift modulo one for
+// halton. the replicate means are independent unbiased estimates, so their spread is the
+// error estimate. a point is the center of its cell of width 2^-32, so it is never 0 or 1
+// and can go through an inverse cdf.
+
+namespace NAMESPACE {
+	class QuasiRandomSampler {
+	 public:
+        QuasiRandomSampler(void);
+		~QuasiRandomSampler(void);
+		
+		// copy constructor
+		QuasiRandomSampler(const QuasiRandomSampler &sampler);
+		
+		// initialize, the shifts are drawn from pRNG
+		void Initialize(long dimension, long numReplicates, gsl_rng *pRNG);
+		void CleanUp(void);
+		
+		// the points of a replicate are generated in order, Start goes to point index
+		void Start(long replicate, long index = 0);
+		void Next(double u[]);
+		
+		// position of the next point
+		long Replicate(void) const;
+		long Index(void) const;
+		
+		// size
+		long Dimension(void) const;
+		long NumReplicates(void) const;
+		std::string SequenceName(void) const;
+		
+		// member data
+	private:
+		gsl_qrng *mpQRNG;
+		long mDimension;
+		long mNumReplicates;
+		bool mDigitalShift;
+		
+		// current replicate and its shift
+		long mReplicate;
+		long mIndex;
+		Array<unsigned int> mShift;
+		Array<double> mBase;
+	};
+	
+	
+	
+	inline QuasiRandomSampler::QuasiRandomSampler()
+	{
+		mpQRNG = NULL;
+		mDimension = 0;
+		mNumReplicates = 0;
+		mDigitalShift = true;
+		mReplicate = 0;
+		mIndex = 0;
+		
+		return;
+	}
+	
+	
+	
+	inline QuasiRandomSampler::~QuasiRandomSampler()
+	{
+		CleanUp();
+		return;
+	}
+	
+	
+	
+	inline long QuasiRandomSampler::Replicate() const
+	{
+		return mReplicate;
+	}
+	
+	
+	
+	inline long QuasiRandomSampler::Index() const
+	{
+		return mIndex;
+	}
+	
+	
+	
+	inline long QuasiRandomSampler::Dimension() const
+	{
+		return mDimension;
+	}
+	
+	
+	
+	inline long QuasiRandomSampler::NumReplicates() const
+	{
+		return mNumReplicates;
+	}
+}
+
+#endif // _quasirandom_h_
@@ -68,6 +68,10 @@ namespace NAMESPACE {
 		void TurnOnRunClock(void);
 		bool RunClockOn(void) const;
 		
+		// benchmark of the right hand sides and solvers instead of a run
+		void TurnOnBenchmark(void);
+		bool BenchmarkOn(void) const;
+		
 		// random number generator
 		void SetGSLRandomNumberGeneratorName(std::string rngName);
 		std::string RandomNumberGeneratorName(void) const;
@@ -78,6 +82,26 @@ namespace NAMESPACE {
 		void SetGSLSolverName(std::string solverName);
 		std::string SolverName(void) const;
 		
+		// step size for the fixed step solvers
+		void SetTimeStep(double timeStep);
+		double TimeStep(void) const;
+		
+		// dense output, the solvers step past output times and interpolate
+		void TurnOnDenseOutput(void);
+		bool DenseOutputOn(void) const;
+		
+		// right hand side evaluation
+		void SetRHSMethod(std::string rhsMethod);
+		RHSMethod GetRHSMethod(void) const;
+		
+		// threads used to evolve the systems, <= 0 means one per core
+		void SetNumThreads(long numThreads);
+		long NumThreads(void) const;
+		
+		// systems evolved together by a BatchIntegrator, 0 means one at a time
+		void SetBatchSize(long batchSize);
+		long BatchSize(void) const;
+		
         // scalar error controls
         void SetLocalRelativeError(double value);
 		void SetLocalAbsoluteError(double value);
@@ -91,9 +115,21 @@ namespace NAMESPACE {
 		void SetInputDirectory(std::string inputFile);
 		std::string InputDirectory(void) const;
 		
-		// output file streams
+		// mode file, text, binary (see trajectoryfile.h) or chunked (see chunkedtrajectory.h)
+		void SetModeFileFormat(std::string format);
+		ModeFileFormat GetModeFileFormat(void) const;
+		
+		// write the output on a separate thread
+		void TurnOnAsyncOutput(void);
+		bool AsyncOutputOn(void) const;
+		
+		// output file streams, appended to when restarting, and cut back to the size they
+		// had at the checkpoint
+		void TurnOnAppendOutput(void);
 		void OpenOutputStream(OutputFileStreamType streamType, std::string fileName);
 		std::ofstream& GetOutputStream(OutputFileStreamType streamType);
+		long long OutputStreamSize(OutputFileStreamType streamType);
+		void TruncateOutputStream(OutputFileStreamType streamType, long long size);
 	
 	protected:
 		void MakeOutputScheduleLinear(double timeStep);
@@ -120,6 +156,9 @@ namespace NAMESPACE {
 		// clock
 		bool mRunClockOn;
 		
+		// benchmark
+		bool mBenchmarkOn;
+		
 		// ensemble
 		long mPrintRunCountIncrement;
 		
@@ -129,6 +168,17 @@ namespace NAMESPACE {
 		
 		// solver type
 		std::string mGSLSolverName;
+		double mTimeStep;
+		bool mDenseOutputOn;
+		
+		// right hand side evaluation
+		RHSMethod mRHSMethod;
+		
+		// threads
+		long mNumThreads;
+		
+		// batched evolution
+		long mBatchSize;
 		
 		// scalar error controls
 		double mLocalRelativeError;
@@ -139,7 +189,11 @@ namespace NAMESPACE {
 		std::string mOutputDirectory;
 		
 		// output file streams
+		ModeFileFormat mModeFileFormat;
+		bool mAsyncOutputOn;
+		bool mAppendOutput;
 		Array<std::ofstream> mOutputStream;
+		Array<std::string> mOutputFileName;
 	};
 
 
@@ -157,6 +211,7 @@ namespace NAMESPACE {
 		mTModelOn = false;
 		
 		mRunClockOn = false;
+		mBenchmarkOn = false;
 		mPrintOutputTime = false;
 		
 		mPrintRunCountIncrement = 0;
@@ -165,6 +220,14 @@ namespace NAMESPACE {
 		mLocalAbsoluteError = -1.0;
 		
 		mGSLSolverName = DEFAULT_GSL_SOLVER;
+		mTimeStep = DEFAULT_TIME_STEP;
+		mDenseOutputOn = false;
+		mRHSMethod = DIRECT_RHS;
+		mNumThreads = DEFAULT_NUM_THREADS;
+		mBatchSize = 0;
+		mModeFileFormat = TEXT_MODE_FILE;
+		mAsyncOutputOn = false;
+		mAppendOutput = false;
 		
 		mGSLRandomNumberGeneratorName = DEFAULT_GSL_RANDOM_NUMBER_GENERATOR;
 		mRandomSeed = DEFAULT_RANDOM_SEED;
@@ -173,6 +236,7 @@ namespace NAMESPACE {
 		mOutputDirectory = DEFAULT_OUTPUT_DIRECTORY;
 		
 		mOutputStream.SetSize(END_OUTPUT_STREAM);
+		mOutputFileName.SetSize(END_OUTPUT_STREAM);
 		
 		
 		return;
@@ -303,6 +367,20 @@ namespace NAMESPACE {
 	
 	
 	
+	inline void RunControl::TurnOnBenchmark()
+	{
+		mBenchmarkOn = true;
+	}
+	
+	
+	
+	inline bool RunControl::BenchmarkOn() const
+	{
+		return mBenchmarkOn;
+	}
+	
+	
+	
 	inline void RunControl::SetGSLRandomNumberGeneratorName(std::string rngName)
 	{
 		mGSLRandomNumberGeneratorName = rngName;
@@ -347,6 +425,79 @@ namespace NAMESPACE {
 	
 	
 	
+	inline void RunControl::SetTimeStep(double timeStep)
+	{
+		if (timeStep <= 0.0)
+			ThrowException("RunControl::SetTimeStep : non-positive time step");
+		
+		mTimeStep = timeStep;
+		return;
+	}
+	
+	
+	
+	inline double RunControl::TimeStep() const
+	{
+		return mTimeStep;
+	}
+	
+	
+	
+	inline RHSMethod RunControl::GetRHSMethod() const
+	{
+		return mRHSMethod;
+	}
+	
+	
+	
+	inline void RunControl::TurnOnDenseOutput()
+	{
+		mDenseOutputOn = true;
+		return;
+	}
+	
+	
+	
+	inline bool RunControl::DenseOutputOn() const
+	{
+		return mDenseOutputOn;
+	}
+	
+	
+	
+	inline void RunControl::SetNumThreads(long numThreads)
+	{
+		mNumThreads = numThreads;
+		return;
+	}
+	
+	
+	
+	inline long RunControl::NumThreads() const
+	{
+		return mNumThreads;
+	}
+	
+	
+	
+	inline void RunControl::SetBatchSize(long batchSize)
+	{
+		if (batchSize < 0)
+			ThrowException("RunControl::SetBatchSize : negative batch size");
+		
+		mBatchSize = batchSize;
+		return;
+	}
+	
+	
+	
+	inline long RunControl::BatchSize() const
+	{
+		return mBatchSize;
+	}
+	
+	
+	
 	inline long RunControl::NumOutputTimes() const
 	{
 		return mOutputSchedule.Size();
@@ -443,9 +594,49 @@ namespace NAMESPACE {
 	
 	
 
+	inline ModeFileFormat RunControl::GetModeFileFormat() const
+	{
+		return mModeFileFormat;
+	}
+	
+	
+	
+	inline void RunControl::TurnOnAsyncOutput()
+	{
+		mAsyncOutputOn = true;
+		return;
+	}
+	
+	
+	
+	inline bool RunControl::AsyncOutputOn() const
+	{
+		return mAsyncOutputOn;
+	}
+	
+	
+	
+	inline void RunControl::TurnOnAppendOutput()
+	{
+		mAppendOutput = true;
+		return;
+	}
+	
+	
+	
 	inline void RunControl::OpenOutputStream(OutputFileStreamType streamType, std::string fileName)
 	{
-		OpenOutputFile(mOutputDirectory + fileName, mOutputStream[streamType]);
+		mOutputFileName[streamType] = mOutputDirectory + fileName;
+		
+		if (mAppendOutput == false) {
+			OpenOutputFile(mOutputFileName[streamType], mOutputStream[streamType]);
+			return;
+		}
+		
+		mOutputStream[streamType].open(mOutputFileName[streamType].c_str(), std::ios::out | std::ios::app);
+		if (mOutputStream[streamType].is_open() == false)
+			ThrowException("RunControl::OpenOutputStream : could not open " + mOutputFileName[streamType]);
+		
 		return;
 	}
 
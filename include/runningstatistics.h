@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _runningstatistics_h_
+#define _runningstatistics_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+#include "checkpoint.h"
+
+// running mean of a vector of samples, one entry per (output time, mode). samples are
+// added one at a time with the incremental update mean += (x - mean) / n, and two
+// accumulators (e.g. from different threads) are merged with
+//
+// mean = meanA + (meanB - meanA) nB / (nA + nB)
+//
+// (Chan et al.), so merging per-block accumulators in a fixed order gives the same
+// result however the blocks were distributed.
+
+namespace NAMESPACE {
+	class RunningStatistics {
+	 public:
+        RunningStatistics(void);
+		~RunningStatistics(void) { };
+		
+		// initialize
+		void Initialize(long size);
+		void Reset(void);
+		
+		// accumulate
+		void Add(const Array<double> &sample);
+		void Merge(const RunningStatistics &statistics);
+		void Merge(long count, const Array<double> &mean);
+		
+		// restart
+		void WriteCheckpoint(Checkpoint &checkpoint) const;
+		void ReadCheckpoint(Checkpoint &checkpoint);
+		
+		// results
+		long Count(void) const;
+		long Size(void) const;
+		double Mean(long i) const;
+		
+		// member data
+	private:
+		long mCount;
+		Array<double> mMean;
+	};
+	
+	
+	
+	inline RunningStatistics::RunningStatistics()
+	{
+		mCount = 0;
+		return;
+	} 
+	
+	
+	
+	inline long RunningStatistics::Count() const
+	{
+		return mCount;
+	}
+	
+	
+	
+	inline long RunningStatistics::Size() const
+	{
+		return mMean.Size();
+	}
+	
+	
+	
+	inline double RunningStatistics::Mean(long i) const
+	{
+		return mMean[i];
+	}
+}
+
+#endif // _runningstatistics_h_	
@@ -0,0 +1,617 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _sdirk2_h_
+#define _sdirk2_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "opbeconst.h"
+#include "utility.h"
+#include "stepcontrol.h"
+
+#include <math.h>
+
+// two stage, second order, L-stable singly diagonally implicit Runge-Kutta method
+// (Alexander) for stiff runs with many modes. with gamma = 1 - 1 / sqrt(2)
+//
+// z_1   = y + h gamma f(t + gamma h, z_1)
+// z_2   = y + h (1 - gamma) k_1 + h gamma f(t + h, z_2),   k_i = f(t + c_i h, z_i)
+// y_new = z_2
+//
+// and the embedded first order solution y + h k_1, so the error estimate is
+// h gamma (k_2 - k_1), filtered through the preconditioner below so that it stays
+// bounded for the stiff modes.
+//
+// each stage is solved with Newton's method, and each Newton step (I - h gamma J) d = r
+// with restarted GMRES, so the Jacobian is never formed and the memory is O(N) per
+// Krylov vector instead of O(N^2). the Jacobian-vector products come from differences
+// of the right hand side, which are exact (up to round-off) when f is a polynomial in u:
+//
+// degree 2:  J v = (f(u + v) - f(u - v)) / 2
+// degree 3:  J v = (8 (f(u + v / 2) - f(u - v / 2)) - (f(u + v) - f(u - v))) / 6
+//
+// (v is scaled to the size of u first). the Burgers right hand side is quadratic, cubic
+// with the t-model. GMRES is right preconditioned with the inverse of I - h gamma L, where
+// L is the diagonal (viscous) part of the Jacobian. Function is a functor with
+//
+// void operator()(double t, const double u[], double uDot[])
+
+namespace NAMESPACE {
+	template <class Function>
+	class SDIRK2 {
+	 public:
+        SDIRK2(void);
+		~SDIRK2(void) { };
+		
+		// initialize, linear is the diagonal of the linear part of f, degree the degree of f in u
+		void Initialize(const Function &function, const Array<double> &linear, short degree,
+						double absoluteError, double relativeError);
+		
+		// evolve y from t to t1, h is the suggested step size, updated on return
+		void Evolve(double &t, double t1, double &h, double y[]);
+		
+		// one accepted step from t, not past t1
+		void TakeStep(double &t, double t1, double &h, double y[]);
+		
+		// right hand side evaluations and Krylov iterations since Initialize
+		long NumEvaluations(void) const;
+		long NumKrylovIterations(void) const;
+		
+	private:
+		bool Step(double t, double h, const double y[]);
+		bool SolveStage(double t, double hGamma, const double base[], double z[]);
+		void SolveLinearSystem(double t, double hGamma, const double z[], const double r[], double x[]);
+		void ApplyOperator(double t, double hGamma, const double z[], const double v[], double w[]);
+		void JacobianProduct(double t, const double z[], const double v[], double jv[]);
+		double WeightedNorm(const double y[], const double x[]) const;
+		
+		// member data
+	private:
+		Function mFunction;
+		long mSize;
+		short mDegree;
+		double mAbsoluteError;
+		double mRelativeError;
+		
+		// diagonal linear part, and 1 / (1 - h gamma L_i) for the step size mPreconditionerStep
+		Array<double> mLinear;
+		Array<double> mPreconditioner;
+		double mPreconditionerStep;
+		
+		// stages
+		Array<double> mK1;
+		Array<double> mK2;
+		Array<double> mBase;
+		Array<double> mYNew;
+		Array<double> mYError;
+		
+		// Newton and GMRES scratch space
+		Array<double> mF;
+		Array<double> mResidual;
+		Array<double> mDelta;
+		Array<double> mUPlus;
+		Array<double> mUMinus;
+		Array<double> mFPlus;
+		Array<double> mFMinus;
+		Array<double> mKrylov;
+		Array<double> mHessenberg;
+		Array<double> mCosine;
+		Array<double> mSine;
+		Array<double> mG;
+		Array<double> mW;
+		Array<double> mV;
+		
+		StepControl mStepControl;
+		long mNumEvaluations;
+		long mNumKrylovIterations;
+		
+		static const double mGamma;
+	};
+	
+	
+	
+	template <class Function>
+	const double SDIRK2<Function>::mGamma = 1.0 - 1.0 / sqrt(2.0);
+	
+	
+	
+	template <class Function>
+	inline SDIRK2<Function>::SDIRK2()
+	{
+		mSize = 0;
+		mDegree = 2;
+		mAbsoluteError = 0.0;
+		mRelativeError = 0.0;
+		mPreconditionerStep = 0.0;
+		mNumEvaluations = 0;
+		mNumKrylovIterations = 0;
+		
+		return;
+	} 
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::Initialize(const Function &function, const Array<double> &linear, short degree,
+									  double absoluteError, double relativeError)
+	{
+		if (linear.Size() <= 0)
+			ThrowException("SDIRK2::Initialize : empty linear part");
+		
+		if (degree < 1 || degree > 3)
+			ThrowException("SDIRK2::Initialize : the right hand side must have degree 1, 2 or 3");
+		
+		mFunction = function;
+		mSize = linear.Size();
+		mDegree = degree;
+		mAbsoluteError = absoluteError;
+		mRelativeError = relativeError;
+		
+		mLinear = linear;
+		mPreconditioner.SetSize(mSize);
+		mPreconditionerStep = 0.0;
+		
+		mK1.SetSize(mSize);
+		mK2.SetSize(mSize);
+		mBase.SetSize(mSize);
+		mYNew.SetSize(mSize);
+		mYError.SetSize(mSize);
+		
+		mF.SetSize(mSize);
+		mResidual.SetSize(mSize);
+		mDelta.SetSize(mSize);
+		mUPlus.SetSize(mSize);
+		mUMinus.SetSize(mSize);
+		mFPlus.SetSize(mSize);
+		mFMinus.SetSize(mSize);
+		mW.SetSize(mSize);
+		mV.SetSize(mSize);
+		
+		long m = GMRES_RESTART;
+		mKrylov.SetSize((m + 1) * mSize);
+		mHessenberg.SetSize((m + 1) * m);
+		mCosine.SetSize(m);
+		mSine.SetSize(m);
+		mG.SetSize(m + 1);
+		
+		// the stepper order, as gsl gives its control
+		mStepControl.Initialize(absoluteError, relativeError, 2);
+		mNumEvaluations = 0;
+		mNumKrylovIterations = 0;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	inline long SDIRK2<Function>::NumEvaluations() const
+	{
+		return mNumEvaluations;
+	}
+	
+	
+	
+	template <class Function>
+	inline long SDIRK2<Function>::NumKrylovIterations() const
+	{
+		return mNumKrylovIterations;
+	}
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::Evolve(double &t, double t1, double &h, double y[])
+	{
+		while (t < t1)
+			TakeStep(t, t1, h, y);
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::TakeStep(double &t, double t1, double &h, double y[])
+	{
+		if (t >= t1)
+			return;
+		
+		double hStep = h;
+		bool finalStep = false;
+		
+		if (t + hStep >= t1) {
+			hStep = t1 - t;
+			finalStep = true;
+		}
+		
+		StepAdjustment adjustment;
+		double hNew;
+		
+		while (true) {
+			hNew = hStep;
+			
+			if (Step(t, hStep, y)) {
+				double errorRatio = mStepControl.ErrorRatio(mYNew.Begin(), mYError.Begin(), mSize);
+				adjustment = mStepControl.AdjustStepSize(errorRatio, hNew);
+				
+				if (adjustment != STEP_DECREASE)
+					break;
+			}
+			else {
+				// Newton didn't converge
+				hNew *= 0.25;
+			}
+			
+			if (t + hNew == t)
+				ThrowException("SDIRK2::Evolve : step size underflow");
+			
+			hStep = hNew;
+			finalStep = false;
+		}
+		
+		for (long i = 0; i < mSize; ++i)
+			y[i] = mYNew[i];
+		
+		if (finalStep)
+			t = t1;
+		else
+			t += hStep;
+		
+		// a step shortened to land on t1 doesn't shrink the next step
+		if (finalStep == false || hNew > h)
+			h = hNew;
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	bool SDIRK2<Function>::Step(double t, double h, const double y[])
+	{
+		double hGamma = h * mGamma;
+		
+		if (h != mPreconditionerStep) {
+			for (long i = 0; i < mSize; ++i)
+				mPreconditioner[i] = 1.0 / (1.0 - hGamma * mLinear[i]);
+			
+			mPreconditionerStep = h;
+		}
+		
+		// first stage, starting from y
+		for (long i = 0; i < mSize; ++i) {
+			mBase[i] = y[i];
+			mYNew[i] = y[i];
+		}
+		
+		if (SolveStage(t + hGamma, hGamma, mBase.Begin(), mYNew.Begin()) == false)
+			return false;
+		
+		for (long i = 0; i < mSize; ++i)
+			mK1[i] = (mYNew[i] - mBase[i]) / hGamma;
+		
+		// second stage, starting from the base plus h gamma k_1
+		for (long i = 0; i < mSize; ++i) {
+			mBase[i] = y[i] + h * (1.0 - mGamma) * mK1[i];
+			mYNew[i] = mBase[i] + hGamma * mK1[i];
+		}
+		
+		if (SolveStage(t + h, hGamma, mBase.Begin(), mYNew.Begin()) == false)
+			return false;
+		
+		for (long i = 0; i < mSize; ++i) {
+			mK2[i] = (mYNew[i] - mBase[i]) / hGamma;
+			mYError[i] = hGamma * (mK2[i] - mK1[i]) * mPreconditioner[i];
+		}
+		
+		return true;
+	}
+	
+	
+	
+	template <class Function>
+	bool SDIRK2<Function>::SolveStage(double t, double hGamma, const double base[], double z[])
+	{
+		// Newton for z - base - h gamma f(t, z) = 0, z holds the initial guess
+		double previousNorm = 0.0;
+		
+		for (short iteration = 0; iteration < NEWTON_MAX_ITERATIONS; ++iteration) {
+			mFunction(t, z, mF.Begin());
+			++mNumEvaluations;
+			
+			for (long i = 0; i < mSize; ++i)
+				mResidual[i] = base[i] + hGamma * mF[i] - z[i];
+			
+			SolveLinearSystem(t, hGamma, z, mResidual.Begin(), mDelta.Begin());
+			
+			for (long i = 0; i < mSize; ++i)
+				z[i] += mDelta[i];
+			
+			double norm = WeightedNorm(z, mDelta.Begin());
+			if (norm != norm)
+				return false;
+			
+			if (norm <= NEWTON_TOLERANCE)
+				return true;
+			
+			// diverging
+			if (iteration > 0 && norm > 2.0 * previousNorm)
+				return false;
+			
+			previousNorm = norm;
+		}
+		
+		return false;
+	}
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::SolveLinearSystem(double t, double hGamma, const double z[], const double r[], double x[])
+	{
+		// restarted GMRES for (I - h gamma J) P x = r, with P the diagonal preconditioner
+		// and x = P x' on return. Givens rotations keep the least squares problem triangular
+		long n = mSize;
+		long m = GMRES_RESTART;
+		
+		double rNorm = 0.0;
+		for (long i = 0; i < n; ++i) {
+			x[i] = 0.0;
+			rNorm += r[i] * r[i];
+		}
+		
+		rNorm = sqrt(rNorm);
+		if (rNorm == 0.0)
+			return;
+		
+		double tolerance = GMRES_RELATIVE_TOLERANCE * rNorm;
+		double *krylov = mKrylov.Begin();
+		
+		for (short restart = 0; restart < GMRES_MAX_RESTARTS; ++restart) {
+			// residual of the current x, which is r itself on the first pass
+			double *v0 = krylov;
+			if (restart == 0) {
+				for (long i = 0; i < n; ++i)
+					v0[i] = r[i];
+			}
+			else {
+				ApplyOperator(t, hGamma, z, x, mW.Begin());
+				for (long i = 0; i < n; ++i)
+					v0[i] = r[i] - mW[i];
+			}
+			
+			double beta = 0.0;
+			for (long i = 0; i < n; ++i)
+				beta += v0[i] * v0[i];
+			
+			beta = sqrt(beta);
+			if (beta <= tolerance)
+				return;
+			
+			for (long i = 0; i < n; ++i)
+				v0[i] /= beta;
+			
+			mG[0] = beta;
+			for (long j = 1; j <= m; ++j)
+				mG[j] = 0.0;
+			
+			long k = 0;
+			while (k < m) {
+				double *vk = krylov + k * n;
+				double *vNext = krylov + (k + 1) * n;
+				
+				for (long i = 0; i < n; ++i)
+					mV[i] = mPreconditioner[i] * vk[i];
+				
+				ApplyOperator(t, hGamma, z, mV.Begin(), vNext);
+				++mNumKrylovIterations;
+				
+				// modified Gram-Schmidt, column k of the Hessenberg matrix
+				double *column = mHessenberg.Begin() + k * (m + 1);
+				for (long j = 0; j <= k; ++j) {
+					const double *vj = krylov + j * n;
+					
+					double dot = 0.0;
+					for (long i = 0; i < n; ++i)
+						dot += vNext[i] * vj[i];
+					
+					for (long i = 0; i < n; ++i)
+						vNext[i] -= dot * vj[i];
+					
+					column[j] = dot;
+				}
+				
+				double norm = 0.0;
+				for (long i = 0; i < n; ++i)
+					norm += vNext[i] * vNext[i];
+				
+				norm = sqrt(norm);
+				column[k + 1] = norm;
+				
+				if (norm > 0.0) {
+					for (long i = 0; i < n; ++i)
+						vNext[i] /= norm;
+				}
+				
+				// previous rotations, then a new one to zero column[k + 1]
+				for (long j = 0; j < k; ++j) {
+					double a = column[j];
+					double b = column[j + 1];
+					column[j] = mCosine[j] * a + mSine[j] * b;
+					column[j + 1] = -mSine[j] * a + mCosine[j] * b;
+				}
+				
+				double d = sqrt(column[k] * column[k] + column[k + 1] * column[k + 1]);
+				if (d == 0.0) {
+					mCosine[k] = 1.0;
+					mSine[k] = 0.0;
+				}
+				else {
+					mCosine[k] = column[k] / d;
+					mSine[k] = column[k + 1] / d;
+				}
+				
+				column[k] = d;
+				column[k + 1] = 0.0;
+				
+				mG[k + 1] = -mSine[k] * mG[k];
+				mG[k] = mCosine[k] * mG[k];
+				
+				++k;
+				
+				// converged, or the Krylov space is invariant
+				if (fabs(mG[k]) <= tolerance || norm == 0.0)
+					break;
+			}
+			
+			// back substitution for the coefficients, stored in mG
+			for (long j = k - 1; j >= 0; --j) {
+				const double *column = mHessenberg.Begin() + j * (m + 1);
+				mG[j] /= column[j];
+				
+				for (long i = 0; i < j; ++i)
+					mG[i] -= column[i] * mG[j];
+			}
+			
+			for (long i = 0; i < n; ++i) {
+				double sum = 0.0;
+				for (long j = 0; j < k; ++j)
+					sum += mG[j] * krylov[j * n + i];
+				
+				x[i] += mPreconditioner[i] * sum;
+			}
+			
+			if (k < m)
+				return;
+		}
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::ApplyOperator(double t, double hGamma, const double z[], const double v[], double w[])
+	{
+		JacobianProduct(t, z, v, w);
+		
+		for (long i = 0; i < mSize; ++i)
+			w[i] = v[i] - hGamma * w[i];
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	void SDIRK2<Function>::JacobianProduct(double t, const double z[], const double v[], double jv[])
+	{
+		// scale v to the size of z, the differences are exact so a large perturbation
+		// only costs round-off relative to f(z)
+		double zNorm = 0.0;
+		double vNorm = 0.0;
+		for (long i = 0; i < mSize; ++i) {
+			if (fabs(z[i]) > zNorm)
+				zNorm = fabs(z[i]);
+			
+			if (fabs(v[i]) > vNorm)
+				vNorm = fabs(v[i]);
+		}
+		
+		if (vNorm == 0.0) {
+			for (long i = 0; i < mSize; ++i)
+				jv[i] = 0.0;
+			
+			return;
+		}
+		
+		if (zNorm == 0.0)
+			zNorm = 1.0;
+		
+		double sigma = zNorm / vNorm;
+		
+		if (mDegree == 1) {
+			// f(z + sigma v) - f(z) is exact for an affine f
+			for (long i = 0; i < mSize; ++i)
+				mUPlus[i] = z[i] + sigma * v[i];
+			
+			mFunction(t, mUPlus.Begin(), mFPlus.Begin());
+			mFunction(t, z, mFMinus.Begin());
+			mNumEvaluations += 2;
+			
+			for (long i = 0; i < mSize; ++i)
+				jv[i] = (mFPlus[i] - mFMinus[i]) / sigma;
+			
+			return;
+		}
+		
+		// f(z + sigma v) - f(z - sigma v) = 2 sigma J v + (sigma^3 / 3) D^3 f [v, v, v]
+		for (long i = 0; i < mSize; ++i) {
+			mUPlus[i] = z[i] + sigma * v[i];
+			mUMinus[i] = z[i] - sigma * v[i];
+		}
+		
+		mFunction(t, mUPlus.Begin(), mFPlus.Begin());
+		mFunction(t, mUMinus.Begin(), mFMinus.Begin());
+		mNumEvaluations += 2;
+		
+		if (mDegree == 2) {
+			for (long i = 0; i < mSize; ++i)
+				jv[i] = (mFPlus[i] - mFMinus[i]) / (2.0 * sigma);
+			
+			return;
+		}
+		
+		// the same at sigma / 2 cancels the cubic term
+		for (long i = 0; i < mSize; ++i) {
+			jv[i] = -(mFPlus[i] - mFMinus[i]);
+			mUPlus[i] = z[i] + 0.5 * sigma * v[i];
+			mUMinus[i] = z[i] - 0.5 * sigma * v[i];
+		}
+		
+		mFunction(t, mUPlus.Begin(), mFPlus.Begin());
+		mFunction(t, mUMinus.Begin(), mFMinus.Begin());
+		mNumEvaluations += 2;
+		
+		for (long i = 0; i < mSize; ++i)
+			jv[i] = (jv[i] + 8.0 * (mFPlus[i] - mFMinus[i])) / (6.0 * sigma);
+		
+		return;
+	}
+	
+	
+	
+	template <class Function>
+	double SDIRK2<Function>::WeightedNorm(const double y[], const double x[]) const
+	{
+		// the same scale as the step size control
+		double norm = 0.0;
+		for (long i = 0; i < mSize; ++i) {
+			double r = fabs(x[i]) / (mAbsoluteError + mRelativeError * fabs(y[i]));
+			if (r > norm)
+				norm = r;
+		}
+		
+		return norm;
+	}
+}
+
+#endif // _sdirk2_h_
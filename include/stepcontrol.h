@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _stepcontrol_h_
+#define _stepcontrol_h_
+
+#include "namespace.h"
+#include "opbeenums.h"
+#include "utility.h"
+
+#include <math.h>
+
+// adaptive step size control for the native steppers, the same rule as
+// gsl_odeiv_control_y_new: with D_i = absoluteError + relativeError |y_i| and
+// r = max_i |yErr_i| / D_i, a step is rejected and h shrunk when r > 1.1, and
+// h is grown when r < 0.5. order is the order of the stepper, as gsl_odeiv_step_order
+// hands it to the gsl control (5 for rkck).
+
+namespace NAMESPACE {
+	class StepControl {
+	 public:
+        StepControl(void);
+		~StepControl(void) { };
+		
+		// initialize
+		void Initialize(double absoluteError, double relativeError, short order);
+		
+		// error ratio r for a vector of n values
+		double ErrorRatio(const double y[], const double yErr[], long n) const;
+		
+		// new step size from r
+		StepAdjustment AdjustStepSize(double errorRatio, double &h) const;
+		
+		// member data
+	private:
+		double mAbsoluteError;
+		double mRelativeError;
+		short mOrder;
+	};
+	
+	
+	
+	inline StepControl::StepControl()
+	{
+		mAbsoluteError = 0.0;
+		mRelativeError = 0.0;
+		mOrder = 1;
+		
+		return;
+	} 
+	
+	
+	
+	inline void StepControl::Initialize(double absoluteError, double relativeError, short order)
+	{
+		if (absoluteError < 0.0 || relativeError < 0.0 || absoluteError + relativeError <= 0.0)
+			ThrowException("StepControl::Initialize : bad error tolerances");
+		
+		if (order <= 0)
+			ThrowException("StepControl::Initialize : non-positive order");
+		
+		mAbsoluteError = absoluteError;
+		mRelativeError = relativeError;
+		mOrder = order;
+		
+		return;
+	}
+	
+	
+	
+	inline double StepControl::ErrorRatio(const double y[], const double yErr[], long n) const
+	{
+		double ratio = 0.0;
+		for (long i = 0; i < n; ++i) {
+			double r = fabs(yErr[i]) / (mAbsoluteError + mRelativeError * fabs(y[i]));
+			if (r > ratio)
+				ratio = r;
+		}
+		
+		return ratio;
+	}
+	
+	
+	
+	inline StepAdjustment StepControl::AdjustStepSize(double errorRatio, double &h) const
+	{
+		const double safety = 0.9;
+		
+		if (errorRatio > 1.1) {
+			double r = safety / pow(errorRatio, 1.0 / mOrder);
+			if (r < 0.2)
+				r = 0.2;
+			
+			h *= r;
+			return STEP_DECREASE;
+		}
+		
+		if (errorRatio < 0.5) {
+			double r = 5.0;
+			if (errorRatio > 0.0)
+				r = safety / pow(errorRatio, 1.0 / (mOrder + 1.0));
+			
+			if (r > 5.0)
+				r = 5.0;
+			
+			if (r < 1.0)
+				r = 1.0;
+			
+			h *= r;
+			return STEP_INCREASE;
+		}
+		
+		return STEP_UNCHANGED;
+	}
+}
+
+#endif // _stepcontrol_h_	
@@ -25,6 +25,7 @@
 #include "runcontrol.h"
 #include "modeindex.h"
 #include "opbeparameter.h"
+#include "integrator.h"
 
 #include <fstream>
 
@@ -44,16 +45,24 @@ namespace NAMESPACE {
 		void SetModeIndex(const ModeIndex *pModeIndex);
 		void CleanUpSolver(void);
 		
+		// restart, time, modes and solver state
+		void WriteCheckpoint(Checkpoint &checkpoint) const;
+		void ReadCheckpoint(Checkpoint &checkpoint);
+		
 		// time
 		void SetCurrentTime(double t);
+		double CurrentTime(void) const;
 		
 		// modes
 		void SetNumModes(long numModes);
+		const Array<double> &Modes(void) const;
+		void SetModes(const Array<double> &modes);
 		double GetMode(long modeIndex) const;
 		double U(long i) const;
 		double U(long i, long j, long k) const;
 		void RHS(Array<double> &rhs) const;
 		void RatioTModel(Array<double> &ratio) const;
+		void BenchmarkRHS(long numEvaluations) const;
 		
 		// initial conditions
 		void SetInitialCondition(long modeIndex, double value);
@@ -75,6 +84,7 @@ namespace NAMESPACE {
 		
 	private:
 		void GSLEvolve(double t1);
+		RHSParameters &RHSWorkspace(bool tModelOn) const;
 		
 		// member data
 	protected:
@@ -93,6 +103,13 @@ namespace NAMESPACE {
 		
 		// time
 		double mCurrentTime;
+		
+		// ode solver state, owned by each System
+		Integrator mIntegrator;
+		
+		// right hand side workspace for RHS and RatioTModel, set up on first use and
+		// kept, so the fft plans aren't made again on every call
+		mutable RHSParameters mRHSWorkspace;
 	};
 
 
@@ -141,6 +158,20 @@ namespace NAMESPACE {
 	
 	
 	
+	inline double System::CurrentTime() const
+	{
+		return mCurrentTime;
+	}
+	
+	
+	
+	inline const Array<double> &System::Modes() const
+	{
+		return mMode;
+	}
+	
+	
+	
 	inline void System::SetInitialCondition(long modeIndex, double value)
 	{	
 		mInitialCondition[modeIndex] = value;
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _threadpool_h_
+#define _threadpool_h_
+
+#include "namespace.h"
+#include "utility.h"
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+// a fixed set of worker threads that run numTasks independent tasks, Execute(0, worker), ...,
+// Execute(numTasks - 1, worker), where worker (0, ..., NumThreads() - 1) identifies the thread,
+// so a task can use per-thread scratch objects. the tasks are dealt out in contiguous blocks, one deque per
+// worker. a worker takes tasks from the front of its own deque and, when that is empty,
+// steals from the back of the others, so a few expensive tasks (e.g. stiff systems
+// that take many more adaptive steps) don't leave the other workers idle. the calling
+// thread is worker 0, so a pool of one thread runs everything serially.
+//
+// if tasks throw, the remaining tasks still run and Run rethrows the exception of the lowest numbered failing task on the
+// calling thread, after all the other tasks have finished.
+
+namespace NAMESPACE {
+	class ThreadPoolTask {
+	 public:
+		virtual ~ThreadPoolTask(void) { };
+		virtual void Execute(long taskIndex, long worker) = 0;
+	};
+	
+	
+	
+	class ThreadPool {
+	 public:
+        ThreadPool(void);
+		~ThreadPool(void);
+        
+		// copy constructor
+		ThreadPool(const ThreadPool &pool);
+		
+		// initialize, numThreads <= 0 means one thread per core
+		void Initialize(long numThreads);
+		void CleanUp(void);
+		long NumThreads(void) const;
+		
+		// run task.Execute(i, worker) for i = 0, ..., numTasks - 1 and wait for them to finish
+		void Run(ThreadPoolTask &task, long numTasks);
+		
+	private:
+		struct TaskQueue {
+			std::mutex mMutex;
+			std::deque<long> mTask;
+		};
+		
+		void WorkerLoop(long worker, unsigned long generation);
+		void ExecuteTasks(long worker);
+		bool NextTask(long worker, long &taskIndex);
+		
+		// member data
+	private:
+		long mNumThreads;
+		std::vector<std::thread> mThread;
+		TaskQueue *mpQueue;
+		
+		// current batch of tasks
+		ThreadPoolTask *mpTask;
+		unsigned long mGeneration;
+		long mNumBusyWorkers;
+		bool mStop;
+		
+		// first failure (lowest task index) in the current batch
+		long mFailedTask;
+		std::exception_ptr mException;
+		
+		std::mutex mMutex;
+		std::condition_variable mStartCondition;
+		std::condition_variable mDoneCondition;
+	};
+	
+	
+	
+	inline ThreadPool::ThreadPool()
+	{
+		mNumThreads = 1;
+		mpQueue = NULL;
+		mpTask = NULL;
+		mGeneration = 0;
+		mNumBusyWorkers = 0;
+		mStop = false;
+		mFailedTask = -1;
+		
+		return;
+	} 
+	
+	
+	
+	inline ThreadPool::~ThreadPool()
+	{
+		CleanUp();
+		return;
+	}
+	
+	
+	
+	inline long ThreadPool::NumThreads() const
+	{
+		return mNumThreads;
+	}
+}
+
+#endif // _threadpool_h_	
@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _trajectoryfile_h_
+#define _trajectoryfile_h_
+
+#include "array.h"
+#include "namespace.h"
+#include "utility.h"
+
+#include <string>
+#include <fstream>
+
+// binary mode history. the file starts with a header
+//
+// char[8]  "OPBETRJ"      magic (null terminated)
+// uint32   1              version
+// uint32   0x01020304     byte order mark, written in the byte order of the writer
+// uint32   4 or 8         bytes per value (float32 or float64)
+// uint32   0              padding
+// int64    numModes
+// int64    numSystems
+// int64    numTimes
+// float64  time[numTimes] the output schedule
+//
+// followed by one record of numModes values per (time, system), time major, so record
+// (n, s) starts at header size + (n numSystems + s) numModes bytes per value. the header
+// holds the whole schedule, a run that stopped early just has fewer records, which the
+// reader finds from the file size.
+
+namespace NAMESPACE {
+	class TrajectoryWriter {
+	 public:
+        TrajectoryWriter(void);
+		~TrajectoryWriter(void);
+		
+		// copy constructor
+		TrajectoryWriter(const TrajectoryWriter &writer);
+		
+		// open and close, Resume continues a file after its first numTimesWritten output
+		// times and cuts off anything past them
+		void Open(const std::string &fileName, long numModes, long numSystems, 
+				  const Array<double> &time, bool singlePrecision = false);
+		void Resume(const std::string &fileName, long numModes, long numSystems, 
+					const Array<double> &time, bool singlePrecision, long numTimesWritten);
+		void Close(void);
+		bool IsOpen(void) const;
+		
+		// one record, the systems of each output time in order
+		void Write(const Array<double> &mode);
+		void Write(const double mode[]);
+		
+		// puts the buffered records in the file
+		void Flush(void);
+		
+		// records written so far
+		long NumRecords(void) const;
+		
+	private:
+		void AllocateBuffer(void);
+		
+		// member data
+	private:
+		std::ofstream mFile;
+		long mNumModes;
+		long mNumSystems;
+		long mNumTimes;
+		bool mSinglePrecision;
+		long mNumRecords;
+		
+		// records are collected here and written in large blocks
+		Array<char> mBuffer;
+		long mBufferSize;
+	};
+	
+	
+	
+	class TrajectoryReader {
+	 public:
+        TrajectoryReader(void);
+		~TrajectoryReader(void) { };
+		
+		// copy constructor
+		TrajectoryReader(const TrajectoryReader &reader);
+		
+		// open and close
+		void Open(const std::string &fileName);
+		void Close(void);
+		
+		// header
+		long NumModes(void) const;
+		long NumSystems(void) const;
+		long NumTimes(void) const;
+		double Time(long n) const;
+		bool SinglePrecision(void) const;
+		
+		// output times with all their records in the file
+		long NumCompleteTimes(void) const;
+		
+		// modes of a system at output time n
+		void Read(long n, long system, Array<double> &mode);
+		
+		// member data
+	private:
+		std::ifstream mFile;
+		long mNumModes;
+		long mNumSystems;
+		long mNumTimes;
+		bool mSinglePrecision;
+		Array<double> mTime;
+		
+		// offset of the first record, and the number of records in the file
+		long long mDataOffset;
+		long mNumRecords;
+		
+		Array<float> mFloatBuffer;
+	};
+	
+	
+	
+	inline TrajectoryWriter::TrajectoryWriter()
+	{
+		mNumModes = 0;
+		mNumSystems = 0;
+		mNumTimes = 0;
+		mSinglePrecision = false;
+		mNumRecords = 0;
+		mBufferSize = 0;
+		
+		return;
+	}
+	
+	
+	
+	inline TrajectoryWriter::~TrajectoryWriter()
+	{
+		// a failed flush can't be reported from a destructor (it would terminate), call
+		// Close to see it
+		try {
+			Close();
+		}
+		catch (...) {
+		}
+		
+		return;
+	}
+	
+	
+	
+	inline bool TrajectoryWriter::IsOpen() const
+	{
+		return mFile.is_open();
+	}
+	
+	
+	
+	inline long TrajectoryWriter::NumRecords() const
+	{
+		return mNumRecords;
+	}
+	
+	
+	
+	inline TrajectoryReader::TrajectoryReader()
+	{
+		mNumModes = 0;
+		mNumSystems = 0;
+		mNumTimes = 0;
+		mSinglePrecision = false;
+		mDataOffset = 0;
+		mNumRecords = 0;
+		
+		return;
+	}
+	
+	
+	
+	inline long TrajectoryReader::NumModes() const
+	{
+		return mNumModes;
+	}
+	
+	
+	
+	inline long TrajectoryReader::NumSystems() const
+	{
+		return mNumSystems;
+	}
+	
+	
+	
+	inline long TrajectoryReader::NumTimes() const
+	{
+		return mNumTimes;
+	}
+	
+	
+	
+	inline double TrajectoryReader::Time(long n) const
+	{
+		return mTime[n];
+	}
+	
+	
+	
+	inline bool TrajectoryReader::SinglePrecision() const
+	{
+		return mSinglePrecision;
+	}
+	
+	
+	
+	inline long TrajectoryReader::NumCompleteTimes() const
+	{
+		if (mNumSystems <= 0)
+			return 0;
+		
+		return mNumRecords / mNumSystems;
+	}
+}
+
+#endif // _trajectoryfile_h_
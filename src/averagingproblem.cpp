@@ -26,6 +26,9 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <map>
+#include <vector>
+#include <climits>
 
 using namespace NAMESPACE;
 using namespace std;
@@ -44,6 +47,16 @@ void AveragingProblem::Run(const std::string &fileName)
     ReadInputFile(fileName);
 	
 	// run
+	if (mQuadratureType == SPARSE_GRID_QUADRATURE) {
+		RunSparseGrid();
+		return;
+	}
+	
+	if (mQuadratureType == MONTE_CARLO_QUADRATURE) {
+		RunMonteCarlo();
+		return;
+	}
+	
 	if (mNumUnresolvedModes == 1) {
 		RunOneUnresolved();
 		return;
@@ -61,17 +74,21 @@ void AveragingProblem::RunOneUnresolved()
 {	
 	switch (mQuadratureType) {
 	case ADAPTIVE_QUADRATURE:
-		ThrowException("AveragingProblem::Run : adaptive integration not implemented");
+		RunAdaptiveOneUnresolved();
 		break;
 	
 	case MONTE_CARLO_QUADRATURE:
-		ThrowException("AveragingProblem::Run : Monte Carlo integration not implemented");
+		RunMonteCarlo();
 		break;
 		
 	case FIXED_SPACING_QUADRATURE:
 		RunFixedSpacingOneUnresolved();
 		break;
 	
+	case GAUSS_HERMITE_QUADRATURE:
+		RunGaussHermiteOneUnresolved();
+		break;
+	
 	default:
 		ThrowException("AveragingProblem::Run : quadrature type not set");
 	}
@@ -84,25 +101,175 @@ void AveragingProblem::RunOneUnresolved()
 
 void AveragingProblem::RunFixedSpacingOneUnresolved()
 {
+	// trapezoid rule against the density on the domain where it is above the tolerance
+	const Density &density = UnresolvedDensity(0);
+	
 	double xMin, xMax;
-	mInitialDensity[0].DomainBounds(DEFAULT_QUADRATURE_TOLERANCE, xMin, xMax);
-
-	// set initial conditions
-	Initialize(mQuadratureNumGridPoints);
+	density.DomainBounds(DEFAULT_QUADRATURE_TOLERANCE, xMin, xMax);
+	
+	Array<double> node(mQuadratureNumGridPoints);
+	Array<double> weight(mQuadratureNumGridPoints);
+	
 	double dX = (xMax - xMin) / (mQuadratureNumGridPoints - 1.0);
 	for (long i = 0; i < mQuadratureNumGridPoints; ++i) {
-		double x = xMin + i * dX;
-		mSystem[i].SetInitialCondition(mNumModes - 1, x);
+		node[i] = xMin + i * dX;
+		weight[i] = dX * density.Value(node[i]);
+		
+		if (i == 0 || i == mQuadratureNumGridPoints - 1)
+			weight[i] *= 0.5;
 	}
 	
-	Initialize();
-	mState = PROBLEM_START;
-	AverageOneUnresolved();
+	RunQuadrature(node, weight);
 	
-	mRunControl.SetState(SYSTEM_RUN);
-	for (long i = 0; i < mRunControl.NumOutputTimes(); ++i) {
-		Evolve(mRunControl.OutputTime(i));
-		AverageOneUnresolved();
+	return;
+}
+
+
+
+void AveragingProblem::RunGaussHermiteOneUnresolved()
+{
+	// gauss-hermite rule matched to the mean and sigma of the density, n points are exact for
+	// averages that are polynomials of degree < 2n in the unresolved initial value
+	HermitePolynomial hermite;
+	hermite.Initialize(UnresolvedDensity(0), 1);
+	
+	Array<double> node, weight;
+	hermite.GaussQuadrature(mQuadratureNumGridPoints, node, weight);
+	
+	RunQuadrature(node, weight);
+	
+	return;
+}
+
+
+
+void AveragingProblem::RunSparseGrid()
+{
+	Array<double> node, weight;
+	MakeSparseGrid(mSparseGridLevel, node, weight);
+	
+	cout << "Sparse grid level " << mSparseGridLevel << " has " << weight.Size() << " nodes" << endl;
+	
+	RunQuadrature(node, weight);
+	
+	return;
+}
+
+
+
+void AveragingProblem::RunAdaptiveOneUnresolved()
+{
+	// adaptive simpson quadrature against the density on the domain where it is above the
+	// tolerance. a panel [a, b] is accepted when the simpson rule on [a, b] and the composite
+	// rule on its two halves agree to within the panel's share of the tolerance, for every
+	// resolved mode at every output time, and split otherwise. the nodes of a panel are nodes
+	// of its halves, so a split only needs the new quarter points, and every trajectory that
+	// has been integrated is kept and reused
+	const Density &density = UnresolvedDensity(0);
+	
+	double xMin, xMax;
+	density.DomainBounds(mQuadratureTolerance, xMin, xMax);
+	
+	long historySize = mRunControl.NumOutputTimes() * mNumResolvedModes;
+	double minWidth = (xMax - xMin) / (1L << ADAPTIVE_QUADRATURE_MAX_LEVEL);
+	
+	// resolved modes of every node integrated so far, history[k historySize + ...] for node k
+	map<double, long> nodeIndex;
+	vector<double> history;
+	
+	// panels still to be checked, 2^(level - 1) equal ones to start with
+	vector< pair<double, double> > panel;
+	long numPanels = 1L << (mInitialQuadratureLevel - 1);
+	for (long k = 0; k < numPanels; ++k)
+		panel.push_back(make_pair(xMin + k * (xMax - xMin) / numPanels, xMin + (k + 1) * (xMax - xMin) / numPanels));
+	
+	Array<double> total(historySize);
+	for (long i = 0; i < historySize; ++i)
+		total[i] = 0.0;
+	
+	Array<double> x(5), f(5), estimate(historySize);
+	while (panel.empty() == false) {
+		// the nodes of the panels that haven't been integrated yet
+		vector<double> newNode;
+		for (size_t p = 0; p < panel.size(); ++p) {
+			double a = panel[p].first;
+			double b = panel[p].second;
+			double m = 0.5 * (a + b);
+			
+			double node[5] = {a, 0.5 * (a + m), m, 0.5 * (m + b), b};
+			for (short q = 0; q < 5; ++q) {
+				if (nodeIndex.insert(make_pair(node[q], -1L)).second)
+					newNode.push_back(node[q]);
+			}
+		}
+		
+		if (newNode.empty() == false) {
+			Array<double> node(newNode.size());
+			for (size_t k = 0; k < newNode.size(); ++k)
+				node[k] = newNode[k];
+			
+			Array<double> newHistory;
+			IntegrateNodes(node, newHistory);
+			
+			for (size_t k = 0; k < newNode.size(); ++k) {
+				nodeIndex[newNode[k]] = history.size() / historySize;
+				history.insert(history.end(), newHistory.Begin() + k * historySize, newHistory.Begin() + (k + 1) * historySize);
+			}
+		}
+		
+		// accept or split
+		vector< pair<double, double> > next;
+		for (size_t p = 0; p < panel.size(); ++p) {
+			double a = panel[p].first;
+			double b = panel[p].second;
+			double m = 0.5 * (a + b);
+			
+			x[0] = a;
+			x[1] = 0.5 * (a + m);
+			x[2] = m;
+			x[3] = 0.5 * (m + b);
+			x[4] = b;
+			
+			const double *value[5];
+			for (short q = 0; q < 5; ++q) {
+				value[q] = &history[nodeIndex[x[q]] * historySize];
+				f[q] = density.Value(x[q]);
+			}
+			
+			double h = b - a;
+			double tolerance = mQuadratureTolerance * h / (xMax - xMin);
+			
+			double error = 0.0;
+			for (long i = 0; i < historySize; ++i) {
+				double coarse = h / 6.0 * (f[0] * value[0][i] + 4.0 * f[2] * value[2][i] + f[4] * value[4][i]);
+				double fine = h / 12.0 * (f[0] * value[0][i] + 4.0 * f[1] * value[1][i] + 2.0 * f[2] * value[2][i] + 
+										  4.0 * f[3] * value[3][i] + f[4] * value[4][i]);
+				
+				// the composite rule with its richardson correction
+				estimate[i] = fine + (fine - coarse) / 15.0;
+				error = max(error, fabs(fine - coarse) / 15.0);
+			}
+			
+			if (error > tolerance && h > minWidth) {
+				next.push_back(make_pair(a, m));
+				next.push_back(make_pair(m, b));
+				continue;
+			}
+			
+			for (long i = 0; i < historySize; ++i)
+				total[i] += estimate[i];
+		}
+		
+		panel.swap(next);
+	}
+	
+	cout << "Adaptive quadrature integrated " << nodeIndex.size() << " systems" << endl;
+	
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		for (long i = 0; i < mNumResolvedModes; ++i)
+			mAverage(n, i) = total[n * mNumResolvedModes + i];
+		
+		WriteAverage(n);
 	}
 	
 	mState = PROBLEM_DONE;
@@ -112,34 +279,179 @@ void AveragingProblem::RunFixedSpacingOneUnresolved()
 
 
 
-void AveragingProblem::AverageOneUnresolved()
+void AveragingProblem::IntegrateNodes(const Array<double> &node, Array<double> &history)
 {
-/*
-	static ofstream modeFile, averageFile;
+	// one system per node, node[k d + j] is the initial value of unresolved mode j for
+	// system k (d unresolved modes), and the resolved modes at every output time are put
+	// in history[(k numOutputTimes + n) numResolvedModes + i]
+	long d = mNumUnresolvedModes;
+	long numNodes = node.Size() / d;
+	long numOutputTimes = mRunControl.NumOutputTimes();
+	
+	Initialize(numNodes);
+	for (long k = 0; k < numNodes; ++k) {
+		for (long j = 0; j < d; ++j)
+			mSystem[k].SetInitialCondition(mNumResolvedModes + j, node[k * d + j]);
+	}
 	
-	WriteModesToStream(modeFile);
+	Reset();
+	mState = PROBLEM_RUNNING;
 	
-	averageFile << mCurrentTime << " ";
-	double dX = mSystem[1].InitialCondition(mNumModes - 1) - mSystem[0].InitialCondition(mNumModes - 1);
-	for (long i = 0; i < mNumModes - 1; ++i) {
-		double average = 0.0;
+	history.SetSize(numNodes * numOutputTimes * mNumResolvedModes);
+	
+	mRunControl.SetState(SYSTEM_RUN);
+	for (long n = 0; n < numOutputTimes; ++n) {
+		Evolve(mRunControl.OutputTime(n));
 		
-		// endpoints
-		long j = 0;
-		average += 0.5 * mSystem[j].GetMode(i) * mInitialDensity[0].Value(mSystem[j].InitialCondition(mNumModes - 1));
+		for (long k = 0; k < numNodes; ++k) {
+			for (long i = 0; i < mNumResolvedModes; ++i)
+				history[(k * numOutputTimes + n) * mNumResolvedModes + i] = mSystem[k].GetMode(i);
+		}
+	}
+	
+	return;
+}
+
+
+
+void AveragingProblem::RunMonteCarlo()
+{
+	// (quasi-)monte carlo over any number of unresolved modes. each replicate is a set of
+	// numberofquadraturepoints points in the unit cube, mapped through the inverse cdfs of the
+	// unresolved densities, and the average is the mean over all replicates. the points are
+	// pseudo-random or, with sampling=quasirandom, a shifted low-discrepancy sequence, and
+	// either way the spread of the replicate means gives the error
+	long d = mNumUnresolvedModes;
+	long numPoints = mQuadratureNumGridPoints;
+	long numOutputTimes = mRunControl.NumOutputTimes();
+	long sampleSize = numOutputTimes * mNumResolvedModes;
+	
+	InitializeRandomNumberGenerator();
+	if (mSamplingType == QUASI_RANDOM_SAMPLING)
+		mQuasiRandomSampler.Initialize(d, mNumReplicates, mpGSLRandomNumberGenerator);
+	
+	RunningStatistics statistics;
+	statistics.Initialize(sampleSize);
+	
+	Array<RunningStatistics> replicateStatistics(mNumReplicates);
+	
+	Array<double> u(d), node(numPoints * d), history, sample(sampleSize);
+	for (long r = 0; r < mNumReplicates; ++r) {
+		if (mSamplingType == QUASI_RANDOM_SAMPLING)
+			mQuasiRandomSampler.Start(r);
 		
-		j = mSystem.Size() - 1;
-		average += 0.5 * mSystem[j].GetMode(i) * mInitialDensity[0].Value(mSystem[j].InitialCondition(mNumModes - 1));
+		for (long k = 0; k < numPoints; ++k) {
+			if (mSamplingType == QUASI_RANDOM_SAMPLING) {
+				mQuasiRandomSampler.Next(u.Begin());
+			}
+			else {
+				for (long j = 0; j < d; ++j)
+					u[j] = gsl_rng_uniform_pos(mpGSLRandomNumberGenerator);
+			}
+			
+			for (long j = 0; j < d; ++j)
+				node[k * d + j] = UnresolvedDensity(j).InverseCDF(u[j]);
+		}
 		
-		for (long j = 1; j < mSystem.Size() - 1; ++j) 
-			average += mSystem[j].GetMode(i) * mInitialDensity[0].Value(mSystem[j].InitialCondition(mNumModes - 1));
+		IntegrateNodes(node, history);
 		
-		average *= dX;
+		replicateStatistics[r].Initialize(sampleSize);
+		for (long k = 0; k < numPoints; ++k) {
+			for (long i = 0; i < sampleSize; ++i)
+				sample[i] = history[k * sampleSize + i];
+			
+			replicateStatistics[r].Add(sample);
+		}
 		
-		averageFile << average << " ";
+		statistics.Merge(replicateStatistics[r]);
 	}
-	averageFile << endl;
-	*/
+	
+	for (long n = 0; n < numOutputTimes; ++n) {
+		for (long i = 0; i < mNumResolvedModes; ++i)
+			mAverage(n, i) = statistics.Mean(n * mNumResolvedModes + i);
+		
+		WriteAverage(n);
+	}
+	
+	PrintReplicateError(replicateStatistics);
+	
+	mState = PROBLEM_DONE;
+	
+	return;
+}
+
+
+
+void AveragingProblem::RunQuadrature(const Array<double> &node, const Array<double> &weight)
+{
+	// one system per node, node[i d + j] is the initial value of unresolved mode j for
+	// system i (d unresolved modes)
+	long d = mNumUnresolvedModes;
+	if (node.Size() != weight.Size() * d)
+		ThrowException("AveragingProblem::RunQuadrature : nodes and weights don't match");
+	
+	Initialize(weight.Size());
+	for (long i = 0; i < weight.Size(); ++i) {
+		for (long j = 0; j < d; ++j)
+			mSystem[i].SetInitialCondition(mNumResolvedModes + j, node[i * d + j]);
+	}
+	
+	Reset();
+	mState = PROBLEM_START;
+	
+	mRunControl.SetState(SYSTEM_RUN);
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		Evolve(mRunControl.OutputTime(n));
+		Average(n, weight);
+		WriteAverage(n);
+		WriteOutput();
+	}
+	
+	FinishOutput();
+	
+	mState = PROBLEM_DONE;
+	
+	return;
+}
+
+
+
+void AveragingProblem::Average(long n, const Array<double> &weight)
+{
+	if (weight.Size() != mSystem.Size())
+		ThrowException("AveragingProblem::Average : one weight per system needed");
+	
+	for (long i = 0; i < mNumResolvedModes; ++i) {
+		double average = 0.0;
+		for (long j = 0; j < mSystem.Size(); ++j)
+			average += weight[j] * mSystem[j].GetMode(i);
+		
+		mAverage(n, i) = average;
+	}
+	
+	return;
+}
+
+
+
+void AveragingProblem::WriteAverage(long n)
+{
+	ofstream& fileStream = mRunControl.GetOutputStream(AVERAGE_OUTPUT_STREAM);
+
+	if (fileStream.is_open() == false)
+		return;
+	
+	fileStream << mRunControl.OutputTime(n) << " ";
+	
+	for (long i = 0; i < mNumResolvedModes; ++i) {
+		fileStream << setprecision(10) << mAverage(n, i);
+		
+		if (i != mNumResolvedModes - 1)
+			fileStream << " ";
+	}
+	
+	fileStream << endl;
+	
 	return;
 }
 
@@ -165,7 +477,8 @@ void AveragingProblem::Initialize(long numSystems)
 		mSystem[i].SetInitialConditions(mInitialCondition);
 	}
 	// initialize solver for all systems
-	mSystem[0].InitializeSolver();
+	for (long i = 0; i < numSystems; ++i)
+		mSystem[i].InitializeSolver();
 	
 	
 	return;
@@ -206,24 +519,55 @@ void AveragingProblem::ReadInputFile(const string &fileName)
 		mInitialQuadratureLevel = DEFAULT_INITIAL_QUADRATURE_LEVEL;
 	}
 	else {
-		if (initialLevel <= 0)
-			ThrowException("AveragingProblem::ReadInputFile : non-positive initial quadrature level");
+		if (initialLevel <= 0 || initialLevel > ADAPTIVE_QUADRATURE_MAX_LEVEL)
+			ThrowException("AveragingProblem::ReadInputFile : initial quadrature level out of range");
 
 		mInitialQuadratureLevel = initialLevel;
 	}
 	
-	// quadrature tolerance
-	mQuadratureTolerance = DEFAULT_QUADRATURE_TOLERANCE;
+	// quadrature tolerance, for the adaptive quadrature
+	if (parser.FindFloat("quadraturetolerance=", mQuadratureTolerance) == false)
+		mQuadratureTolerance = DEFAULT_QUADRATURE_TOLERANCE;
+	
+	if (mQuadratureTolerance <= 0.0)
+		ThrowException("AveragingProblem::ReadInputFile : non-positive quadrature tolerance");
 	
-	// grid size for fixed spacing quadrature
+	// number of points for fixed spacing and gauss-hermite quadrature, and per replicate
+	// for monte carlo
 	long gridSize;
-	if (mQuadratureType == FIXED_SPACING_QUADRATURE) {
+	if (mQuadratureType == FIXED_SPACING_QUADRATURE || mQuadratureType == GAUSS_HERMITE_QUADRATURE || 
+		mQuadratureType == MONTE_CARLO_QUADRATURE) {
 		if (parser.FindInteger("numberofquadraturepoints=", gridSize) == false) 
 			mQuadratureNumGridPoints = DEFAULT_QUADRATURE_NUM_POINTS;
+		else if (gridSize > SHRT_MAX)
+			ThrowException("AveragingProblem::ReadInputFile : too many quadrature points");
 		else 
 			mQuadratureNumGridPoints = gridSize;
 	}
 	
+	if (mQuadratureType == MONTE_CARLO_QUADRATURE && mQuadratureNumGridPoints < 1)
+		ThrowException("AveragingProblem::ReadInputFile : monte carlo needs at least one point per replicate");
+	
+	if (mQuadratureType == FIXED_SPACING_QUADRATURE && mQuadratureNumGridPoints < 2)
+		ThrowException("AveragingProblem::ReadInputFile : fixed spacing quadrature needs at least two points");
+	
+	if (mQuadratureNumGridPoints < 0)
+		ThrowException("AveragingProblem::ReadInputFile : negative number of quadrature points");
+	
+	// level of the sparse grid
+	long sparseGridLevel;
+	if (parser.FindInteger("sparsegridlevel=", sparseGridLevel)) {
+		if (sparseGridLevel <= 0)
+			ThrowException("AveragingProblem::ReadInputFile : non-positive sparse grid level");
+		
+		mSparseGridLevel = sparseGridLevel;
+	}
+	
+	// averages of the resolved modes
+	string outputName;
+	if (parser.FindFileName("averagefile=", outputName))
+		mRunControl.OpenOutputStream(AVERAGE_OUTPUT_STREAM, outputName);
+	
 	// check to make sure all required densities have been set
 	CheckDensity();
 	
@@ -235,13 +579,48 @@ void AveragingProblem::ReadInputFile(const string &fileName)
 
 void AveragingProblem::CheckDensity() const
 {
-	ThrowException("AveragingProblem::CheckDensity : not implemented");
+	// each unresolved mode needs a (gaussian) density, the resolved ones start at their
+	// initial conditions
+	for (long j = 0; j < mNumUnresolvedModes; ++j) {
+		const Density &density = UnresolvedDensity(j);
+		
+		if (density.Type() != ONE_DIMENSIONAL_GAUSSIAN)
+			ThrowException("AveragingProblem::CheckDensity : only gaussian densities are supported");
+		
+		if (density.GetParameter(1) <= 0.0)
+			ThrowException("AveragingProblem::CheckDensity : non-positive sigma for mode " + 
+						   ConvertIntegerToString(mNumResolvedModes + j));
+	}
 	
 	return;
 }
 
 
 
+const Density &AveragingProblem::UnresolvedDensity(long j) const
+{
+	// density of unresolved mode j, i.e. mode mNumResolvedModes + j, found by its mode index
+	long mode = mNumResolvedModes + j;
+	long found = -1;
+	
+	for (long i = 0; i < mInitialDensity.Size(); ++i) {
+		if (mInitialDensity[i].GetModeIndex() != mode)
+			continue;
+		
+		if (found >= 0)
+			ThrowException("AveragingProblem::UnresolvedDensity : two densities for mode " + ConvertIntegerToString(mode));
+		
+		found = i;
+	}
+	
+	if (found < 0)
+		ThrowException("AveragingProblem::UnresolvedDensity : no density for mode " + ConvertIntegerToString(mode));
+	
+	return mInitialDensity[found];
+}
+
+
+
 void AveragingProblem::SetQuadratureType(string quadratureType)
 {
 	if (quadratureType == "adaptive") {
@@ -258,6 +637,16 @@ void AveragingProblem::SetQuadratureType(string quadratureType)
 		mQuadratureType = FIXED_SPACING_QUADRATURE;
 		return;
 	}
+	
+	if (quadratureType == "gausshermite") {
+		mQuadratureType = GAUSS_HERMITE_QUADRATURE;
+		return;
+	}
+	
+	if (quadratureType == "sparsegrid") {
+		mQuadratureType = SPARSE_GRID_QUADRATURE;
+		return;
+	}
 
 	ThrowException("AveragingProblem::SetQuadratureType : no type corresponds to string " + quadratureType);
 	
@@ -266,6 +655,130 @@ void AveragingProblem::SetQuadratureType(string quadratureType)
 
 
 
+void AveragingProblem::MakeSparseGrid(short level, Array<double> &node, Array<double> &weight) const
+{
+	// smolyak's combination technique for the product density of the unresolved modes,
+	//
+	// A(w, d) = sum_{w - d + 1 <= |l| <= w} (-1)^{w - |l|} C(d - 1, w - |l|) Q_{l_1} x ... x Q_{l_d}
+	//
+	// with w = level + d - 1 and Q_l the 2l - 1 point gauss-hermite rule of each density, which
+	// is exact for polynomials of total degree < 2 level. the rules have an odd number of points,
+	// so they all share the mean, and the nodes the tensor rules have in common are merged.
+	// a merged weight is kept with the sum of the magnitudes of its terms
+	long d = mNumUnresolvedModes;
+	long w = level + d - 1;
+	long maxLevel = level;
+	
+	// one dimensional rules, rule[j * maxLevel + l - 1] for mode j and level l
+	Array< Array<double> > ruleNode(d * maxLevel);
+	Array< Array<double> > ruleWeight(d * maxLevel);
+	
+	for (long j = 0; j < d; ++j) {
+		HermitePolynomial hermite;
+		hermite.Initialize(UnresolvedDensity(j), 1);
+		
+		for (long l = 1; l <= maxLevel; ++l)
+			hermite.GaussQuadrature(2 * l - 1, ruleNode[j * maxLevel + l - 1], ruleWeight[j * maxLevel + l - 1]);
+	}
+	
+	// binomial coefficients C(d - 1, k)
+	Array<double> binomial(d);
+	binomial[0] = 1.0;
+	for (long k = 1; k < d; ++k)
+		binomial[k] = binomial[k - 1] * (d - k) / k;
+	
+	map<vector<double>, pair<double, double> > grid;
+	vector<long> l(d, 1);
+	vector<long> point(d);
+	vector<double> x(d);
+	
+	// every multi-index with l_j >= 1 and |l| <= w, in odometer order
+	while (true) {
+		long sum = 0;
+		for (long j = 0; j < d; ++j)
+			sum += l[j];
+		
+		if (sum >= w - d + 1) {
+			double coefficient = binomial[w - sum];
+			if ((w - sum) % 2 == 1)
+				coefficient = -coefficient;
+			
+			// the tensor product of the rules Q_{l_j}
+			for (long j = 0; j < d; ++j)
+				point[j] = 0;
+			
+			while (true) {
+				double product = coefficient;
+				for (long j = 0; j < d; ++j) {
+					x[j] = ruleNode[j * maxLevel + l[j] - 1][point[j]];
+					product *= ruleWeight[j * maxLevel + l[j] - 1][point[j]];
+				}
+				
+				pair<double, double> &merged = grid[x];
+				merged.first += product;
+				merged.second += fabs(product);
+				
+				long j = 0;
+				while (j < d && ++point[j] == 2 * l[j] - 1) {
+					point[j] = 0;
+					++j;
+				}
+				
+				if (j == d)
+					break;
+			}
+		}
+		
+		// next multi-index
+		long j = 0;
+		while (j < d) {
+			++l[j];
+			
+			long total = 0;
+			for (long k = 0; k < d; ++k)
+				total += l[k];
+			
+			if (total <= w)
+				break;
+			
+			l[j] = 1;
+			++j;
+		}
+		
+		if (j == d)
+			break;
+	}
+	
+	// drop the nodes whose weights cancelled to round-off of their own terms, a small
+	// weight that didn't cancel is kept, the exactness needs it
+	typedef map<vector<double>, pair<double, double> >::const_iterator GridIterator;
+	
+	long numNodes = 0;
+	for (GridIterator p = grid.begin(); p != grid.end(); ++p) {
+		if (fabs(p->second.first) > SPARSE_GRID_WEIGHT_CUTOFF * p->second.second)
+			++numNodes;
+	}
+	
+	node.SetSize(numNodes * d);
+	weight.SetSize(numNodes);
+	
+	long i = 0;
+	for (GridIterator p = grid.begin(); p != grid.end(); ++p) {
+		if (fabs(p->second.first) <= SPARSE_GRID_WEIGHT_CUTOFF * p->second.second)
+			continue;
+		
+		for (long j = 0; j < d; ++j)
+			node[i * d + j] = p->first[j];
+		
+		weight[i] = p->second.first;
+		++i;
+	}
+	
+	return;
+}
+
+
+
 void AveragingProblem::Test(const string &fileName)
 {
 	
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchintegrator.h"
+#include "opbeconst.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+// Cash-Karp coefficients, as in gsl's rkck
+static const double ck_a[6][5] = {
+	{0.0, 0.0, 0.0, 0.0, 0.0},
+	{1.0 / 5.0, 0.0, 0.0, 0.0, 0.0},
+	{3.0 / 40.0, 9.0 / 40.0, 0.0, 0.0, 0.0},
+	{3.0 / 10.0, -9.0 / 10.0, 6.0 / 5.0, 0.0, 0.0},
+	{-11.0 / 54.0, 5.0 / 2.0, -70.0 / 27.0, 35.0 / 27.0, 0.0},
+	{1631.0 / 55296.0, 175.0 / 512.0, 575.0 / 13824.0, 44275.0 / 110592.0, 253.0 / 4096.0}
+};
+
+static const double ck_c[6] = {0.0, 1.0 / 5.0, 3.0 / 10.0, 3.0 / 5.0, 1.0, 7.0 / 8.0};
+
+// fifth order weights, and the difference from the fourth order ones
+static const double ck_b5[6] = {37.0 / 378.0, 0.0, 250.0 / 621.0, 125.0 / 594.0, 0.0, 512.0 / 1771.0};
+
+static const double ck_ec[6] = {37.0 / 378.0 - 2825.0 / 27648.0, 
+								0.0, 
+								250.0 / 621.0 - 18575.0 / 48384.0, 
+								125.0 / 594.0 - 13525.0 / 55296.0, 
+								-277.0 / 14336.0, 
+								512.0 / 1771.0 - 0.25};
+
+BatchIntegrator::BatchIntegrator(const BatchIntegrator &integrator)
+{
+	ThrowException("BatchIntegrator : copy constructor not implemented");
+	return;
+}
+
+
+
+void BatchIntegrator::Initialize(const RunControl &runControl, const OPBEParameter &parameter, 
+								 long numModes, long batchSize)
+{
+	if (runControl.GetSystemType() != BURGERS_EQUATION)
+		ThrowException("BatchIntegrator::Initialize : only implemented for Burgers equation");
+	
+	if (numModes <= 0 || batchSize <= 0)
+		ThrowException("BatchIntegrator::Initialize : number of modes and batch size must be positive");
+	
+	mEpsilon = parameter.ViscosityCoefficient();
+	mTModelOn = runControl.TModelOn();
+	mNumModes = numModes;
+	mBatchSize = batchSize;
+	
+	long size = numModes * batchSize;
+	mY.SetSize(size);
+	mYNew.SetSize(size);
+	mYError.SetSize(size);
+	mYStage.SetSize(size);
+	for (short s = 0; s < 6; ++s)
+		mK[s].SetSize(size);
+	
+	if (mTModelOn)
+		mWork.SetSize(size);
+	
+	for (long i = 0; i < size; ++i)
+		mY[i] = 0.0;
+	
+	// order 5, what gsl_odeiv_step_order gives the control for rkck
+	mStepControl.Initialize(runControl.GetLocalAbsoluteError(), runControl.GetLocalRelativeError(), 5);
+	
+	Reset();
+	
+	return;
+}
+
+
+
+void BatchIntegrator::Evolve(double &t, double t1)
+{
+	long size = mNumModes * mBatchSize;
+	
+	while (t < t1) {
+		double h = mStepSize;
+		bool finalStep = false;
+		
+		if (t + h >= t1) {
+			h = t1 - t;
+			finalStep = true;
+		}
+		
+		StepAdjustment adjustment;
+		double hNew;
+		
+		while (true) {
+			Step(t, h);
+			
+			hNew = h;
+			double errorRatio = mStepControl.ErrorRatio(mYNew.Begin(), mYError.Begin(), size);
+			adjustment = mStepControl.AdjustStepSize(errorRatio, hNew);
+			
+			if (adjustment != STEP_DECREASE)
+				break;
+			
+			// rejected, try again with the smaller step
+			if (t + hNew == t)
+				ThrowException("BatchIntegrator::Evolve : step size underflow");
+			
+			h = hNew;
+			finalStep = false;
+		}
+		
+		for (long i = 0; i < size; ++i)
+			mY[i] = mYNew[i];
+		
+		if (finalStep)
+			t = t1;
+		else
+			t += h;
+		
+		// a step shortened to land on t1 doesn't shrink the next step
+		if (finalStep == false || hNew > mStepSize)
+			mStepSize = hNew;
+	}
+	
+	return;
+}
+
+
+
+void BatchIntegrator::Step(double t, double h)
+{
+	long size = mNumModes * mBatchSize;
+	
+	TimeDerivative(t, mY.Begin(), mK[0].Begin());
+	
+	for (short s = 1; s < 6; ++s) {
+		double *yStage = mYStage.Begin();
+		const double *y = mY.Begin();
+		
+		for (long i = 0; i < size; ++i)
+			yStage[i] = y[i];
+		
+		for (short j = 0; j < s; ++j) {
+			double a = h * ck_a[s][j];
+			if (a == 0.0)
+				continue;
+			
+			const double *k = mK[j].Begin();
+			for (long i = 0; i < size; ++i)
+				yStage[i] += a * k[i];
+		}
+		
+		TimeDerivative(t + ck_c[s] * h, yStage, mK[s].Begin());
+	}
+	
+	double *yNew = mYNew.Begin();
+	double *yError = mYError.Begin();
+	const double *y = mY.Begin();
+	
+	for (long i = 0; i < size; ++i) {
+		yNew[i] = y[i];
+		yError[i] = 0.0;
+	}
+	
+	for (short s = 0; s < 6; ++s) {
+		double b = h * ck_b5[s];
+		double e = h * ck_ec[s];
+		const double *k = mK[s].Begin();
+		
+		for (long i = 0; i < size; ++i) {
+			yNew[i] += b * k[i];
+			yError[i] += e * k[i];
+		}
+	}
+	
+	return;
+}
+
+
+
+void BatchIntegrator::TimeDerivative(double t, const double u[], double uDot[])
+{
+	// BurgersEquation, member by member, with the batch loop innermost
+	long n = mNumModes;
+	long batch = mBatchSize;
+	
+	for (long k = 1; k <= n; ++k) {
+		double *d = uDot + (k - 1) * batch;
+		const double *uk = u + (k - 1) * batch;
+		
+		double viscosity = -mEpsilon * k * k;
+		for (long b = 0; b < batch; ++b)
+			d[b] = viscosity * uk[b];
+		
+		// 0.5 k sum_{kp = 1}^{N - k} u_kp u_{kp + k}
+		double f1 = 0.5 * k;
+		for (long kp = 1; kp <= n - k; ++kp) {
+			const double *u1 = u + (kp - 1) * batch;
+			const double *u2 = u + (kp + k - 1) * batch;
+			
+			for (long b = 0; b < batch; ++b)
+				d[b] += f1 * u1[b] * u2[b];
+		}
+		
+		// -0.5 sum_{kp = 1}^{k - 1} kp u_kp u_{k - kp}
+		for (long kp = 1; kp <= k - 1; ++kp) {
+			double f2 = -0.5 * kp;
+			const double *u1 = u + (kp - 1) * batch;
+			const double *u2 = u + (k - kp - 1) * batch;
+			
+			for (long b = 0; b < batch; ++b)
+				d[b] += f2 * u1[b] * u2[b];
+		}
+	}
+	
+	if (mTModelOn)
+		TModel(t, u, uDot);
+	
+	return;
+}
+
+
+
+void BatchIntegrator::TModel(double t, const double u[], double uDot[])
+{
+	// BurgersTModel, member by member
+	long n = mNumModes;
+	long batch = mBatchSize;
+	
+	// work_j = sum_{p = j}^{N} (j + N - p) u_p u_{j + N - p}
+	for (long j = 1; j <= n; ++j) {
+		double *work = mWork.Begin() + (j - 1) * batch;
+		for (long b = 0; b < batch; ++b)
+			work[b] = 0.0;
+		
+		for (long p = j; p <= n; ++p) {
+			double f = j + n - p;
+			const double *u1 = u + (p - 1) * batch;
+			const double *u2 = u + (j + n - p - 1) * batch;
+			
+			for (long b = 0; b < batch; ++b)
+				work[b] += f * u1[b] * u2[b];
+		}
+	}
+	
+	// uDot_m += -0.25 t m sum_{j = 1}^{m} work_j u_{j + N - m}
+	for (long m = 1; m <= n; ++m) {
+		double *d = uDot + (m - 1) * batch;
+		double f = -0.25 * t * m;
+		
+		for (long j = 1; j <= m; ++j) {
+			const double *work = mWork.Begin() + (j - 1) * batch;
+			const double *u1 = u + (j + n - m - 1) * batch;
+			
+			for (long b = 0; b < batch; ++b)
+				d[b] += f * work[b] * u1[b];
+		}
+	}
+	
+	return;
+}
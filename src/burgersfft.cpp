@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "burgersfft.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+BurgersFFT::BurgersFFT(const BurgersFFT &fft)
+{
+	ThrowException("BurgersFFT : copy constructor not implemented");
+	return;
+}
+
+
+
+void BurgersFFT::Initialize(long numModes)
+{
+	if (numModes <= 0)
+		ThrowException("BurgersFFT::Initialize : number of modes must be positive");
+
+	CleanUp();
+
+	mNumModes = numModes;
+
+	// the largest index in the convolution is 2N, so a grid of 2N + 1 points
+	// is enough to keep the circular sums from wrapping
+	mGridSize = GoodGridSize(2 * numModes + 1);
+
+	mpRealWavetable = gsl_fft_real_wavetable_alloc(mGridSize);
+	mpHalfComplexWavetable = gsl_fft_halfcomplex_wavetable_alloc(mGridSize);
+	mpWorkspace = gsl_fft_real_workspace_alloc(mGridSize);
+
+	if (mpRealWavetable == NULL || mpHalfComplexWavetable == NULL || mpWorkspace == NULL)
+		ThrowException("BurgersFFT::Initialize : gsl fft allocation failed");
+
+	mSpectrum.SetSize(mGridSize);
+	mCorrelation.SetSize(mGridSize);
+	mConvolution.SetSize(mGridSize);
+	mTModelSum.SetSize(mGridSize);
+
+	return;
+}
+
+
+
+void BurgersFFT::CleanUp()
+{
+	if (mpRealWavetable != NULL)
+		gsl_fft_real_wavetable_free(mpRealWavetable);
+
+	if (mpHalfComplexWavetable != NULL)
+		gsl_fft_halfcomplex_wavetable_free(mpHalfComplexWavetable);
+
+	if (mpWorkspace != NULL)
+		gsl_fft_real_workspace_free(mpWorkspace);
+
+	mpRealWavetable = NULL;
+	mpHalfComplexWavetable = NULL;
+	mpWorkspace = NULL;
+
+	return;
+}
+
+
+
+void BurgersFFT::ComputeSums(const double u[])
+{
+	if (Ready() == false)
+		ThrowException("BurgersFFT::ComputeSums : not initialized");
+
+	// padded mode vector, index 0 is the (absent) zero mode
+	mSpectrum[0] = 0.0;
+	for (long k = 1; k <= mNumModes; ++k)
+		mSpectrum[k] = u[k - 1];
+
+	for (long k = mNumModes + 1; k < mGridSize; ++k)
+		mSpectrum[k] = 0.0;
+
+	gsl_fft_real_transform(mSpectrum.Begin(), 1, mGridSize, mpRealWavetable, mpWorkspace);
+
+	// |U|^2 transforms back to the correlation, U^2 to the convolution
+	PowerSpectrum(mSpectrum, mCorrelation);
+	gsl_fft_halfcomplex_inverse(mCorrelation.Begin(), 1, mGridSize, mpHalfComplexWavetable, mpWorkspace);
+
+	Square(mSpectrum, mConvolution);
+	gsl_fft_halfcomplex_inverse(mConvolution.Begin(), 1, mGridSize, mpHalfComplexWavetable, mpWorkspace);
+
+	return;
+}
+
+
+
+void BurgersFFT::ComputeTModelSums()
+{
+	if (Ready() == false)
+		ThrowException("BurgersFFT::ComputeTModelSums : not initialized");
+
+	// work(j) from the convolution, padded like u
+	long n = mNumModes;
+
+	mTModelSum[0] = 0.0;
+	for (long j = 1; j <= n; ++j)
+		mTModelSum[j] = 0.5 * (j + n) * mConvolution[j + n];
+
+	for (long j = n + 1; j < mGridSize; ++j)
+		mTModelSum[j] = 0.0;
+
+	gsl_fft_real_transform(mTModelSum.Begin(), 1, mGridSize, mpRealWavetable, mpWorkspace);
+
+	// conj(W) U transforms back to sum_j work(j) u_{j + d}, which is stored at index d = N - m
+	ConjugateProduct(mTModelSum, mSpectrum, mTModelSum);
+	gsl_fft_halfcomplex_inverse(mTModelSum.Begin(), 1, mGridSize, mpHalfComplexWavetable, mpWorkspace);
+
+	return;
+}
+
+
+
+void BurgersFFT::PowerSpectrum(const Array<double> &hc, Array<double> &power) const
+{
+	// hc is in gsl halfcomplex storage: hc[0] is the zero frequency, hc[2k - 1] and hc[2k]
+	// are the real and imaginary parts of frequency k, and for even sizes hc[n - 1] is the
+	// real Nyquist term
+	long n = mGridSize;
+
+	power[0] = hc[0] * hc[0];
+
+	for (long k = 1; 2 * k < n; ++k) {
+		double re = hc[2 * k - 1];
+		double im = hc[2 * k];
+
+		power[2 * k - 1] = re * re + im * im;
+		power[2 * k] = 0.0;
+	}
+
+	if (n % 2 == 0)
+		power[n - 1] = hc[n - 1] * hc[n - 1];
+
+	return;
+}
+
+
+
+void BurgersFFT::Square(const Array<double> &hc, Array<double> &square) const
+{
+	long n = mGridSize;
+
+	square[0] = hc[0] * hc[0];
+
+	for (long k = 1; 2 * k < n; ++k) {
+		double re = hc[2 * k - 1];
+		double im = hc[2 * k];
+
+		square[2 * k - 1] = re * re - im * im;
+		square[2 * k] = 2.0 * re * im;
+	}
+
+	if (n % 2 == 0)
+		square[n - 1] = hc[n - 1] * hc[n - 1];
+
+	return;
+}
+
+
+
+void BurgersFFT::ConjugateProduct(const Array<double> &hc1, const Array<double> &hc2, Array<double> &product) const
+{
+	// product may be the same array as hc1 or hc2
+	long n = mGridSize;
+
+	product[0] = hc1[0] * hc2[0];
+
+	for (long k = 1; 2 * k < n; ++k) {
+		double re1 = hc1[2 * k - 1];
+		double im1 = hc1[2 * k];
+		double re2 = hc2[2 * k - 1];
+		double im2 = hc2[2 * k];
+
+		product[2 * k - 1] = re1 * re2 + im1 * im2;
+		product[2 * k] = re1 * im2 - im1 * re2;
+	}
+
+	if (n % 2 == 0)
+		product[n - 1] = hc1[n - 1] * hc2[n - 1];
+
+	return;
+}
+
+
+
+long BurgersFFT::GoodGridSize(long n) const
+{
+	// smallest size >= n with only the factors 2, 3 and 5, for which the gsl
+	// mixed-radix transforms have specialized (fast) passes
+	for (long m = n; ; ++m) {
+		long r = m;
+
+		while (r % 2 == 0)
+			r /= 2;
+
+		while (r % 3 == 0)
+			r /= 3;
+
+		while (r % 5 == 0)
+			r /= 5;
+
+		if (r == 1)
+			return m;
+	}
+
+	return n;
+}
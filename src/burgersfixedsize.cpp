@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "burgersfixedsize.h"
+
+#include <stddef.h>
+
+using namespace NAMESPACE;
+
+// mode counts used by most production inputs
+template void NAMESPACE::BurgersEquationFixedSize<16, false>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<16, true>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<32, false>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<32, true>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<64, false>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<64, true>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<128, false>(double, double, const double[], double[]);
+template void NAMESPACE::BurgersEquationFixedSize<128, true>(double, double, const double[], double[]);
+
+
+
+FixedSizeBurgersFunction NAMESPACE::FixedSizeBurgersEquation(long numModes, bool tModelOn)
+{
+	switch (numModes) {
+	case 16:
+		return tModelOn ? BurgersEquationFixedSize<16, true> : BurgersEquationFixedSize<16, false>;
+		
+	case 32:
+		return tModelOn ? BurgersEquationFixedSize<32, true> : BurgersEquationFixedSize<32, false>;
+		
+	case 64:
+		return tModelOn ? BurgersEquationFixedSize<64, true> : BurgersEquationFixedSize<64, false>;
+		
+	case 128:
+		return tModelOn ? BurgersEquationFixedSize<128, true> : BurgersEquationFixedSize<128, false>;
+		
+	default:
+		return NULL;
+	}
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "burgerskernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OPBE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace NAMESPACE;
+using namespace std;
+
+static double DotProductScalar(const double *x, const double *y, long n)
+{
+	double sum = 0.0;
+	for (long i = 0; i < n; ++i)
+		sum += x[i] * y[i];
+
+	return sum;
+}
+
+
+
+#ifdef OPBE_X86_KERNELS
+__attribute__((target("avx2,fma")))
+static double DotProductAVX2(const double *x, const double *y, long n)
+{
+	__m256d sum0 = _mm256_setzero_pd();
+	__m256d sum1 = _mm256_setzero_pd();
+
+	long i = 0;
+	for (; i + 8 <= n; i += 8) {
+		sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+		sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), sum1);
+	}
+
+	if (i + 4 <= n) {
+		sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+		i += 4;
+	}
+
+	sum0 = _mm256_add_pd(sum0, sum1);
+	__m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+	double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+
+	for (; i < n; ++i)
+		sum += x[i] * y[i];
+
+	return sum;
+}
+
+
+
+__attribute__((target("avx512f")))
+static double DotProductAVX512(const double *x, const double *y, long n)
+{
+	__m512d sum0 = _mm512_setzero_pd();
+	__m512d sum1 = _mm512_setzero_pd();
+
+	long i = 0;
+	for (; i + 16 <= n; i += 16) {
+		sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sum0);
+		sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), sum1);
+	}
+
+	// remaining (< 16) elements with masked loads
+	while (i < n) {
+		long remaining = n - i;
+		__mmask8 mask = (remaining >= 8) ? (__mmask8) 0xFF : (__mmask8) ((1u << remaining) - 1u);
+		sum0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i), sum0);
+		i += 8;
+	}
+
+	return _mm512_reduce_add_pd(_mm512_add_pd(sum0, sum1));
+}
+#endif
+
+
+
+BurgersKernel::BurgersKernel(const BurgersKernel &kernel)
+{
+	ThrowException("BurgersKernel : copy constructor not implemented");
+	return;
+}
+
+
+
+KernelInstructionSet BurgersKernel::BestInstructionSet()
+{
+#ifdef OPBE_X86_KERNELS
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx512f"))
+		return AVX512_KERNEL;
+
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return AVX2_KERNEL;
+#endif
+
+	return SCALAR_KERNEL;
+}
+
+
+
+void BurgersKernel::SetInstructionSet(KernelInstructionSet instructionSet)
+{
+	switch (instructionSet) {
+	case SCALAR_KERNEL:
+		mpDotProduct = DotProductScalar;
+		break;
+
+#ifdef OPBE_X86_KERNELS
+	case AVX2_KERNEL:
+		mpDotProduct = DotProductAVX2;
+		break;
+
+	case AVX512_KERNEL:
+		mpDotProduct = DotProductAVX512;
+		break;
+#endif
+
+	default:
+		ThrowException("BurgersKernel::SetInstructionSet : instruction set not available");
+		break;
+	}
+
+	mInstructionSet = instructionSet;
+
+	return;
+}
+
+
+
+string BurgersKernel::InstructionSetName() const
+{
+	switch (mInstructionSet) {
+	case AVX2_KERNEL:
+		return "avx2";
+
+	case AVX512_KERNEL:
+		return "avx512";
+
+	default:
+		return "scalar";
+	}
+}
+
+
+
+void BurgersKernel::Initialize(long numModes)
+{
+	if (numModes <= 0)
+		ThrowException("BurgersKernel::Initialize : number of modes must be positive");
+
+	mNumModes = numModes;
+
+	mU.SetSize(numModes + 1);
+	mKU.SetSize(numModes + 1);
+	mReversedU.SetSize(numModes + 1);
+	mReversedKU.SetSize(numModes + 1);
+
+	mSum1.SetSize(numModes + 1);
+	mSum2.SetSize(numModes + 1);
+	mWork.SetSize(numModes + 1);
+	mTModelSum.SetSize(numModes + 1);
+
+	mU[0] = 0.0;
+	mKU[0] = 0.0;
+
+	return;
+}
+
+
+
+void BurgersKernel::ComputeSums(const double u[])
+{
+	long n = mNumModes;
+	if (n <= 0)
+		ThrowException("BurgersKernel::ComputeSums : not initialized");
+
+	// mReversedU[i] = u_{N - i}, so u_{k - kp} = mReversedU[N - k + kp]
+	for (long k = 1; k <= n; ++k) {
+		mU[k] = u[k - 1];
+		mKU[k] = k * u[k - 1];
+	}
+
+	for (long i = 0; i <= n; ++i) {
+		mReversedU[i] = mU[n - i];
+		mReversedKU[i] = mKU[n - i];
+	}
+
+	const double *pU = mU.Begin();
+	const double *pKU = mKU.Begin();
+	const double *pReversedU = mReversedU.Begin();
+
+	for (long k = 1; k <= n; ++k) {
+		mSum1[k] = mpDotProduct(pU + 1, pU + 1 + k, n - k);
+		mSum2[k] = mpDotProduct(pKU + 1, pReversedU + n - k + 1, k - 1);
+	}
+
+	return;
+}
+
+
+
+void BurgersKernel::ComputeTModelSums()
+{
+	long n = mNumModes;
+
+	const double *pU = mU.Begin();
+	const double *pReversedKU = mReversedKU.Begin();
+
+	// (j + N - p) u_{j + N - p} = mReversedKU[p - j]
+	for (long j = 1; j <= n; ++j)
+		mWork[j] = mpDotProduct(pU + j, pReversedKU, n - j + 1);
+
+	const double *pWork = mWork.Begin();
+
+	for (long m = 1; m <= n; ++m)
+		mTModelSum[m] = mpDotProduct(pWork + 1, pU + n - m + 1, m);
+
+	return;
+}
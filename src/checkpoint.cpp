@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+using namespace std;
+
+static const char CHECKPOINT_MAGIC[8] = "OPBECKP";
+static const uint32_t CHECKPOINT_VERSION = 1;
+static const uint32_t CHECKPOINT_BYTE_ORDER_MARK = 0x01020304;
+
+Checkpoint::Checkpoint(const Checkpoint &checkpoint)
+{
+	ThrowException("Checkpoint : copy constructor not implemented");
+	return;
+}
+
+
+
+void Checkpoint::Clear()
+{
+	mData.clear();
+	mPosition = 0;
+	
+	return;
+}
+
+
+
+void Checkpoint::WriteInteger(long long value)
+{
+	int64_t v = value;
+	WriteBytes(&v, sizeof(v));
+	
+	return;
+}
+
+
+
+void Checkpoint::WriteDouble(double value)
+{
+	WriteBytes(&value, sizeof(value));
+	return;
+}
+
+
+
+void Checkpoint::WriteArray(const Array<double> &value)
+{
+	WriteInteger(value.Size());
+	if (value.Size() > 0)
+		WriteBytes(value.Begin(), value.Size() * sizeof(double));
+	
+	return;
+}
+
+
+
+void Checkpoint::WriteBytes(const void *data, long numBytes)
+{
+	const char *p = (const char *) data;
+	mData.insert(mData.end(), p, p + numBytes);
+	
+	return;
+}
+
+
+
+void Checkpoint::WriteRandomNumberGenerator(const gsl_rng *pRNG)
+{
+	// the generator's type, so a restart with another generator is caught, and its state
+	string name = gsl_rng_name(pRNG);
+	WriteInteger(name.size());
+	WriteBytes(name.c_str(), name.size());
+	
+	long size = gsl_rng_size(pRNG);
+	WriteInteger(size);
+	WriteBytes(gsl_rng_state(pRNG), size);
+	
+	return;
+}
+
+
+
+void Checkpoint::Save(const string &fileName) const
+{
+	string tmpFileName = fileName + ".tmp";
+	
+	FILE *pFile = fopen(tmpFileName.c_str(), "wb");
+	if (pFile == NULL)
+		ThrowException("Checkpoint::Save : could not open " + tmpFileName);
+	
+	uint32_t word[2] = {CHECKPOINT_VERSION, CHECKPOINT_BYTE_ORDER_MARK};
+	int64_t size = mData.size();
+	uint64_t checksum = Checksum();
+	
+	bool ok = fwrite(CHECKPOINT_MAGIC, 8, 1, pFile) == 1;
+	ok = ok && fwrite(word, sizeof(word), 1, pFile) == 1;
+	ok = ok && fwrite(&size, sizeof(size), 1, pFile) == 1;
+	ok = ok && (size == 0 || fwrite(&mData[0], size, 1, pFile) == 1);
+	ok = ok && fwrite(&checksum, sizeof(checksum), 1, pFile) == 1;
+	
+	// on disk before the rename, else a crash could leave an empty file under the old name
+	ok = ok && fflush(pFile) == 0;
+	ok = ok && fsync(fileno(pFile)) == 0;
+	ok = (fclose(pFile) == 0) && ok;
+	
+	if (ok == false) {
+		remove(tmpFileName.c_str());
+		ThrowException("Checkpoint::Save : could not write " + tmpFileName);
+	}
+	
+	if (rename(tmpFileName.c_str(), fileName.c_str()) != 0)
+		ThrowException("Checkpoint::Save : could not rename " + tmpFileName + " to " + fileName);
+	
+	return;
+}
+
+
+
+void Checkpoint::Load(const string &fileName)
+{
+	Clear();
+	
+	FILE *pFile = fopen(fileName.c_str(), "rb");
+	if (pFile == NULL)
+		ThrowException("Checkpoint::Load : could not open " + fileName);
+	
+	char magic[8];
+	uint32_t word[2];
+	int64_t size = -1;
+	uint64_t checksum = 0;
+	
+	bool ok = fread(magic, 8, 1, pFile) == 1 && memcmp(magic, CHECKPOINT_MAGIC, 8) == 0;
+	ok = ok && fread(word, sizeof(word), 1, pFile) == 1;
+	ok = ok && fread(&size, sizeof(size), 1, pFile) == 1 && size >= 0;
+	
+	if (ok == false) {
+		fclose(pFile);
+		ThrowException("Checkpoint::Load : " + fileName + " is not a checkpoint file");
+	}
+	
+	if (word[0] != CHECKPOINT_VERSION || word[1] != CHECKPOINT_BYTE_ORDER_MARK) {
+		fclose(pFile);
+		ThrowException("Checkpoint::Load : " + fileName + " has another version or byte order");
+	}
+	
+	mData.resize(size);
+	ok = (size == 0 || fread(&mData[0], size, 1, pFile) == 1);
+	ok = ok && fread(&checksum, sizeof(checksum), 1, pFile) == 1;
+	fclose(pFile);
+	
+	if (ok == false || checksum != Checksum()) {
+		Clear();
+		ThrowException("Checkpoint::Load : " + fileName + " is truncated or corrupt");
+	}
+	
+	return;
+}
+
+
+
+long long Checkpoint::ReadInteger()
+{
+	int64_t v;
+	ReadBytes(&v, sizeof(v));
+	
+	return v;
+}
+
+
+
+double Checkpoint::ReadDouble()
+{
+	double value;
+	ReadBytes(&value, sizeof(value));
+	
+	return value;
+}
+
+
+
+void Checkpoint::ReadArray(Array<double> &value)
+{
+	long size = ReadInteger();
+	if (size < 0)
+		ThrowException("Checkpoint::ReadArray : negative size");
+	
+	value.SetSize(size);
+	if (size > 0)
+		ReadBytes(value.Begin(), size * sizeof(double));
+	
+	return;
+}
+
+
+
+void Checkpoint::ReadBytes(void *data, long numBytes)
+{
+	if (numBytes < 0 || mPosition + numBytes > (long) mData.size())
+		ThrowException("Checkpoint::ReadBytes : read past the end of the checkpoint");
+	
+	if (numBytes > 0)
+		memcpy(data, &mData[mPosition], numBytes);
+	
+	mPosition += numBytes;
+	
+	return;
+}
+
+
+
+void Checkpoint::ReadRandomNumberGenerator(gsl_rng *pRNG)
+{
+	long nameSize = ReadInteger();
+	if (nameSize < 0 || mPosition + nameSize > (long) mData.size())
+		ThrowException("Checkpoint::ReadRandomNumberGenerator : bad generator name");
+	
+	string name(&mData[0] + mPosition, nameSize);
+	mPosition += nameSize;
+	
+	if (name != gsl_rng_name(pRNG))
+		ThrowException("Checkpoint::ReadRandomNumberGenerator : checkpoint has generator " + name + 
+					   ", not " + gsl_rng_name(pRNG));
+	
+	long size = ReadInteger();
+	if (size != (long) gsl_rng_size(pRNG))
+		ThrowException("Checkpoint::ReadRandomNumberGenerator : generator state has the wrong size");
+	
+	ReadBytes(gsl_rng_state(pRNG), size);
+	
+	return;
+}
+
+
+
+unsigned long long Checkpoint::Checksum() const
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < mData.size(); ++i) {
+		hash ^= (unsigned char) mData[i];
+		hash *= 0x100000001b3ULL;
+	}
+	
+	return hash;
+}
@@ -0,0 +1,747 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chunkedtrajectory.h"
+#include "opbeconst.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef OPBE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef OPBE_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+using namespace NAMESPACE;
+using namespace std;
+
+static const char CHUNKED_MAGIC[8] = "OPBECHK";
+static const char CHUNKED_INDEX_MAGIC[8] = "OPBEIDX";
+static const uint32_t CHUNKED_VERSION = 1;
+static const uint32_t CHUNKED_BYTE_ORDER_MARK = 0x01020304;
+static const uint32_t CHUNK_TAG = 0x4B4E4843;
+
+// magic, four uint32 and five int64
+static const long CHUNKED_FIXED_HEADER_SIZE = 8 + 4 * 4 + 5 * 8;
+
+// tag, codec and six int64
+static const long CHUNK_HEADER_SIZE = 2 * 4 + 6 * 8;
+
+// number of chunks, index offset, times written and the magic
+static const long CHUNKED_TRAILER_SIZE = 3 * 8 + 8;
+
+
+
+static void Shuffle(const char *in, char *out, long numValues)
+{
+	// byte b of value i goes to out[b numValues + i], so the (mostly equal) sign and
+	// exponent bytes of neighbouring values end up next to each other
+	const long size = sizeof(double);
+	for (long i = 0; i < numValues; ++i) {
+		for (long b = 0; b < size; ++b)
+			out[b * numValues + i] = in[i * size + b];
+	}
+	
+	return;
+}
+
+
+
+static void Unshuffle(const char *in, char *out, long numValues)
+{
+	const long size = sizeof(double);
+	for (long i = 0; i < numValues; ++i) {
+		for (long b = 0; b < size; ++b)
+			out[i * size + b] = in[b * numValues + i];
+	}
+	
+	return;
+}
+
+
+
+static long CompressBound(ChunkCodec codec, long numBytes)
+{
+	switch (codec) {
+#ifdef OPBE_HAVE_ZSTD
+	case ZSTD_CHUNK_CODEC:
+		return ZSTD_compressBound(numBytes);
+#endif
+
+#ifdef OPBE_HAVE_LZ4
+	case LZ4_CHUNK_CODEC:
+		return LZ4_compressBound(numBytes);
+#endif
+	
+	default:
+		return numBytes;
+	}
+}
+
+
+
+static long Compress(ChunkCodec codec, const char *in, long numBytes, char *out, long capacity)
+{
+	switch (codec) {
+#ifdef OPBE_HAVE_ZSTD
+	case ZSTD_CHUNK_CODEC: {
+		size_t size = ZSTD_compress(out, capacity, in, numBytes, CHUNK_ZSTD_LEVEL);
+		if (ZSTD_isError(size))
+			ThrowException("ChunkedTrajectoryWriter : zstd compression failed");
+		
+		return size;
+	}
+#endif
+
+#ifdef OPBE_HAVE_LZ4
+	case LZ4_CHUNK_CODEC: {
+		int size = LZ4_compress_default(in, out, numBytes, capacity);
+		if (size <= 0)
+			ThrowException("ChunkedTrajectoryWriter : lz4 compression failed");
+		
+		return size;
+	}
+#endif
+	
+	case NO_CHUNK_CODEC:
+		memcpy(out, in, numBytes);
+		return numBytes;
+	
+	default:
+		ThrowException("ChunkedTrajectoryWriter : codec not available");
+		return 0;
+	}
+}
+
+
+
+static void Decompress(ChunkCodec codec, const char *in, long numBytes, char *out, long rawBytes)
+{
+	switch (codec) {
+#ifdef OPBE_HAVE_ZSTD
+	case ZSTD_CHUNK_CODEC: {
+		size_t size = ZSTD_decompress(out, rawBytes, in, numBytes);
+		if (ZSTD_isError(size) || (long) size != rawBytes)
+			ThrowException("ChunkedTrajectoryReader : zstd decompression failed");
+		
+		return;
+	}
+#endif
+
+#ifdef OPBE_HAVE_LZ4
+	case LZ4_CHUNK_CODEC: {
+		int size = LZ4_decompress_safe(in, out, numBytes, rawBytes);
+		if (size != rawBytes)
+			ThrowException("ChunkedTrajectoryReader : lz4 decompression failed");
+		
+		return;
+	}
+#endif
+	
+	case NO_CHUNK_CODEC:
+		if (numBytes != rawBytes)
+			ThrowException("ChunkedTrajectoryReader : bad chunk size");
+		
+		memcpy(out, in, numBytes);
+		return;
+	
+	default:
+		ThrowException("ChunkedTrajectoryReader : chunk compressed with a codec that isn't available");
+		return;
+	}
+}
+
+
+
+ChunkedTrajectoryWriter::ChunkedTrajectoryWriter(const ChunkedTrajectoryWriter &writer)
+{
+	ThrowException("ChunkedTrajectoryWriter : copy constructor not implemented");
+	return;
+}
+
+
+
+ChunkCodec ChunkedTrajectoryWriter::BestCodec()
+{
+#if defined(OPBE_HAVE_ZSTD)
+	return ZSTD_CHUNK_CODEC;
+#elif defined(OPBE_HAVE_LZ4)
+	return LZ4_CHUNK_CODEC;
+#else
+	return NO_CHUNK_CODEC;
+#endif
+}
+
+
+
+void ChunkedTrajectoryWriter::Open(const string &fileName, long numModes, long numSystems, const Array<double> &time)
+{
+	if (numModes <= 0 || numSystems <= 0)
+		ThrowException("ChunkedTrajectoryWriter::Open : non-positive number of modes or systems");
+	
+	Close();
+	
+	mFile.open(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+	if (mFile.is_open() == false)
+		ThrowException("ChunkedTrajectoryWriter::Open : could not open " + fileName);
+	
+	mNumModes = numModes;
+	mNumSystems = numSystems;
+	mCodec = BestCodec();
+	
+	// as many output times as fit in the block buffer, and as many modes per chunk
+	// as fit in a chunk of that many times
+	long timeBytes = numSystems * numModes * (long) sizeof(double);
+	mTimesPerChunk = CHUNK_BLOCK_BUFFER_SIZE / timeBytes;
+	if (mTimesPerChunk > 64)
+		mTimesPerChunk = 64;
+	
+	if (mTimesPerChunk < 1)
+		mTimesPerChunk = 1;
+	
+	mModesPerChunk = CHUNK_SIZE / (mTimesPerChunk * numSystems * (long) sizeof(double));
+	if (mModesPerChunk > numModes)
+		mModesPerChunk = numModes;
+	
+	if (mModesPerChunk < 1)
+		mModesPerChunk = 1;
+	
+	// header
+	uint32_t word[4] = {CHUNKED_VERSION, CHUNKED_BYTE_ORDER_MARK, (uint32_t) sizeof(double), (uint32_t) mCodec};
+	int64_t size[5] = {numModes, numSystems, time.Size(), mTimesPerChunk, mModesPerChunk};
+	
+	mFile.write(CHUNKED_MAGIC, 8);
+	mFile.write((const char *) word, sizeof(word));
+	mFile.write((const char *) size, sizeof(size));
+	
+	for (long n = 0; n < time.Size(); ++n) {
+		double t = time[n];
+		mFile.write((const char *) &t, sizeof(double));
+	}
+	
+	if (mFile.fail())
+		ThrowException("ChunkedTrajectoryWriter::Open : could not write header to " + fileName);
+	
+	AllocateBlock();
+	mBlockFirstTime = 0;
+	mNumTimesWritten = 0;
+	mIndex.clear();
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::Resume(const string &fileName, long numModes, long numSystems, 
+									 const Array<double> &time, long numTimesWritten)
+{
+	if (numModes <= 0 || numSystems <= 0 || numTimesWritten < 0 || numTimesWritten > time.Size())
+		ThrowException("ChunkedTrajectoryWriter::Resume : bad sizes");
+	
+	Close();
+	
+	ifstream file(fileName.c_str(), ios::in | ios::binary);
+	if (file.is_open() == false)
+		ThrowException("ChunkedTrajectoryWriter::Resume : could not open " + fileName);
+	
+	char magic[8];
+	uint32_t word[4];
+	int64_t size[5];
+	
+	file.read(magic, 8);
+	file.read((char *) word, sizeof(word));
+	file.read((char *) size, sizeof(size));
+	
+	if (file.fail() || memcmp(magic, CHUNKED_MAGIC, 8) != 0 || word[0] != CHUNKED_VERSION || 
+		word[1] != CHUNKED_BYTE_ORDER_MARK || word[2] != sizeof(double))
+		ThrowException("ChunkedTrajectoryWriter::Resume : " + fileName + " is not a chunked trajectory file");
+	
+	if (size[0] != numModes || size[1] != numSystems || size[2] != time.Size() || size[3] <= 0 || size[4] <= 0)
+		ThrowException("ChunkedTrajectoryWriter::Resume : " + fileName + " has different sizes");
+	
+	for (long n = 0; n < time.Size(); ++n) {
+		double t;
+		file.read((char *) &t, sizeof(double));
+		if (file.fail() || t != time[n])
+			ThrowException("ChunkedTrajectoryWriter::Resume : " + fileName + " has a different output schedule");
+	}
+	
+	// the chunks of the times written, as the reader scans them. chunks of later times,
+	// a torn chunk and the index of a finished run end the scan
+	file.seekg(0, ios::end);
+	long long fileSize = file.tellg();
+	long long offset = CHUNKED_FIXED_HEADER_SIZE + (long long) time.Size() * sizeof(double);
+	long completeTimes = 0;
+	
+	mIndex.clear();
+	while (offset + CHUNK_HEADER_SIZE <= fileSize) {
+		uint32_t chunkWord[2];
+		int64_t chunkSize[6];
+		
+		file.seekg(offset, ios::beg);
+		file.read((char *) chunkWord, sizeof(chunkWord));
+		file.read((char *) chunkSize, sizeof(chunkSize));
+		
+		if (file.fail() || chunkWord[0] != CHUNK_TAG || offset + CHUNK_HEADER_SIZE + chunkSize[5] > fileSize)
+			break;
+		
+		if (chunkSize[0] + chunkSize[1] > numTimesWritten)
+			break;
+		
+		ChunkIndexEntry entry;
+		entry.mFirstTime = chunkSize[0];
+		entry.mNumTimes = chunkSize[1];
+		entry.mFirstMode = chunkSize[2];
+		entry.mNumModes = chunkSize[3];
+		entry.mOffset = offset;
+		mIndex.push_back(entry);
+		
+		if (entry.mFirstMode + entry.mNumModes == numModes)
+			completeTimes = entry.mFirstTime + entry.mNumTimes;
+		
+		offset += CHUNK_HEADER_SIZE + chunkSize[5];
+	}
+	
+	file.close();
+	
+	// the checkpoint flushed the block, so the chunks end at the restart time
+	if (completeTimes != numTimesWritten)
+		ThrowException("ChunkedTrajectoryWriter::Resume : " + fileName + " does not end a block at the restart time");
+	
+	if (truncate(fileName.c_str(), offset) != 0)
+		ThrowException("ChunkedTrajectoryWriter::Resume : could not truncate " + fileName);
+	
+	mFile.open(fileName.c_str(), ios::out | ios::binary | ios::app);
+	if (mFile.is_open() == false)
+		ThrowException("ChunkedTrajectoryWriter::Resume : could not open " + fileName);
+	
+	mNumModes = numModes;
+	mNumSystems = numSystems;
+	mTimesPerChunk = size[3];
+	mModesPerChunk = size[4];
+	mCodec = BestCodec();
+	
+	AllocateBlock();
+	mBlockFirstTime = numTimesWritten;
+	mNumTimesWritten = numTimesWritten;
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::AllocateBlock()
+{
+	mBlock.SetSize(mTimesPerChunk * mNumSystems * mNumModes);
+	mNumRecordsInBlock = 0;
+	
+	long chunkValues = mTimesPerChunk * mNumSystems * mModesPerChunk;
+	mRaw.SetSize(chunkValues);
+	mShuffled.SetSize(chunkValues * sizeof(double));
+	mStored.SetSize(CompressBound(mCodec, chunkValues * sizeof(double)));
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::Close()
+{
+	if (mFile.is_open() == false)
+		return;
+	
+	if (mNumRecordsInBlock > 0)
+		WriteBlock();
+	
+	// index and trailer
+	int64_t indexOffset = mFile.tellp();
+	
+	for (size_t c = 0; c < mIndex.size(); ++c) {
+		int64_t entry[5] = {mIndex[c].mFirstTime, mIndex[c].mNumTimes, mIndex[c].mFirstMode, 
+							mIndex[c].mNumModes, mIndex[c].mOffset};
+		mFile.write((const char *) entry, sizeof(entry));
+	}
+	
+	int64_t trailer[3] = {(int64_t) mIndex.size(), indexOffset, mNumTimesWritten};
+	mFile.write((const char *) trailer, sizeof(trailer));
+	mFile.write(CHUNKED_INDEX_MAGIC, 8);
+	
+	mFile.close();
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::Write(const double mode[])
+{
+	if (mFile.is_open() == false)
+		ThrowException("ChunkedTrajectoryWriter::Write : file not open");
+	
+	memcpy(mBlock.Begin() + mNumRecordsInBlock * mNumModes, mode, mNumModes * sizeof(double));
+	++mNumRecordsInBlock;
+	
+	if (mNumRecordsInBlock == mTimesPerChunk * mNumSystems)
+		WriteBlock();
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::Flush()
+{
+	if (mFile.is_open() == false || mNumRecordsInBlock == 0)
+		return;
+	
+	WriteBlock();
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryWriter::WriteBlock()
+{
+	// a partial last time (some systems missing) is dropped
+	long numTimes = mNumRecordsInBlock / mNumSystems;
+	
+	for (long firstMode = 0; firstMode < mNumModes && numTimes > 0; firstMode += mModesPerChunk) {
+		long numModes = mModesPerChunk;
+		if (firstMode + numModes > mNumModes)
+			numModes = mNumModes - firstMode;
+		
+		// [time][system][mode] to [mode][time][system]
+		long numValues = numModes * numTimes * mNumSystems;
+		long v = 0;
+		for (long i = 0; i < numModes; ++i) {
+			for (long n = 0; n < numTimes; ++n) {
+				const double *record = mBlock.Begin() + n * mNumSystems * mNumModes + firstMode + i;
+				for (long s = 0; s < mNumSystems; ++s)
+					mRaw[v++] = record[s * mNumModes];
+			}
+		}
+		
+		long rawBytes = numValues * sizeof(double);
+		const char *data = (const char *) mRaw.Begin();
+		if (mCodec != NO_CHUNK_CODEC) {
+			Shuffle(data, mShuffled.Begin(), numValues);
+			data = mShuffled.Begin();
+		}
+		
+		long storedBytes = Compress(mCodec, data, rawBytes, mStored.Begin(), mStored.Size());
+		
+		ChunkIndexEntry entry;
+		entry.mFirstTime = mBlockFirstTime;
+		entry.mNumTimes = numTimes;
+		entry.mFirstMode = firstMode;
+		entry.mNumModes = numModes;
+		entry.mOffset = mFile.tellp();
+		mIndex.push_back(entry);
+		
+		uint32_t word[2] = {CHUNK_TAG, (uint32_t) mCodec};
+		int64_t size[6] = {entry.mFirstTime, numTimes, firstMode, numModes, rawBytes, storedBytes};
+		
+		mFile.write((const char *) word, sizeof(word));
+		mFile.write((const char *) size, sizeof(size));
+		mFile.write(mStored.Begin(), storedBytes);
+	}
+	
+	mFile.flush();
+	if (mFile.fail())
+		ThrowException("ChunkedTrajectoryWriter::WriteBlock : write failed");
+	
+	mBlockFirstTime += numTimes;
+	mNumTimesWritten += numTimes;
+	mNumRecordsInBlock = 0;
+	
+	return;
+}
+
+
+
+ChunkedTrajectoryReader::ChunkedTrajectoryReader(const ChunkedTrajectoryReader &reader)
+{
+	ThrowException("ChunkedTrajectoryReader : copy constructor not implemented");
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::Open(const string &fileName)
+{
+	Close();
+	
+	mFile.open(fileName.c_str(), ios::in | ios::binary);
+	if (mFile.is_open() == false)
+		ThrowException("ChunkedTrajectoryReader::Open : could not open " + fileName);
+	
+	char magic[8];
+	uint32_t word[4];
+	int64_t size[5];
+	
+	mFile.read(magic, 8);
+	mFile.read((char *) word, sizeof(word));
+	mFile.read((char *) size, sizeof(size));
+	
+	if (mFile.fail() || memcmp(magic, CHUNKED_MAGIC, 8) != 0)
+		ThrowException("ChunkedTrajectoryReader::Open : " + fileName + " is not a chunked trajectory file");
+	
+	if (word[0] != CHUNKED_VERSION)
+		ThrowException("ChunkedTrajectoryReader::Open : unknown version in " + fileName);
+	
+	if (word[1] != CHUNKED_BYTE_ORDER_MARK)
+		ThrowException("ChunkedTrajectoryReader::Open : " + fileName + " was written with a different byte order");
+	
+	if (word[2] != sizeof(double))
+		ThrowException("ChunkedTrajectoryReader::Open : bad value size in " + fileName);
+	
+	mNumModes = size[0];
+	mNumSystems = size[1];
+	mNumTimes = size[2];
+	mTimesPerChunk = size[3];
+	mModesPerChunk = size[4];
+	
+	if (mNumModes <= 0 || mNumSystems <= 0 || mNumTimes < 0 || mTimesPerChunk <= 0 || mModesPerChunk <= 0)
+		ThrowException("ChunkedTrajectoryReader::Open : bad sizes in " + fileName);
+	
+	mTime.SetSize(mNumTimes);
+	for (long n = 0; n < mNumTimes; ++n)
+		mFile.read((char *) &mTime[n], sizeof(double));
+	
+	if (mFile.fail())
+		ThrowException("ChunkedTrajectoryReader::Open : truncated header in " + fileName);
+	
+	mDataOffset = CHUNKED_FIXED_HEADER_SIZE + (long long) mNumTimes * sizeof(double);
+	
+	mFile.seekg(0, ios::end);
+	mFileSize = mFile.tellg();
+	
+	ReadIndex();
+	
+	long chunkValues = mTimesPerChunk * mNumSystems * mModesPerChunk;
+	mRaw.SetSize(chunkValues);
+	mShuffled.SetSize(chunkValues * sizeof(double));
+	mLoadedChunk = -1;
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::Close()
+{
+	if (mFile.is_open())
+		mFile.close();
+	
+	mFile.clear();
+	mIndex.clear();
+	mNumTimesWritten = 0;
+	mLoadedChunk = -1;
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::ReadIndex()
+{
+	// the index from the trailer, or from the chunk headers when there is none
+	if (mFileSize - mDataOffset < CHUNKED_TRAILER_SIZE) {
+		ScanChunks();
+		return;
+	}
+	
+	int64_t trailer[3];
+	char magic[8];
+	
+	mFile.seekg(mFileSize - CHUNKED_TRAILER_SIZE, ios::beg);
+	mFile.read((char *) trailer, sizeof(trailer));
+	mFile.read(magic, 8);
+	
+	if (mFile.fail() || memcmp(magic, CHUNKED_INDEX_MAGIC, 8) != 0) {
+		mFile.clear();
+		ScanChunks();
+		return;
+	}
+	
+	mIndex.resize(trailer[0]);
+	mNumTimesWritten = trailer[2];
+	
+	mFile.seekg(trailer[1], ios::beg);
+	for (size_t c = 0; c < mIndex.size(); ++c) {
+		int64_t entry[5];
+		mFile.read((char *) entry, sizeof(entry));
+		
+		mIndex[c].mFirstTime = entry[0];
+		mIndex[c].mNumTimes = entry[1];
+		mIndex[c].mFirstMode = entry[2];
+		mIndex[c].mNumModes = entry[3];
+		mIndex[c].mOffset = entry[4];
+	}
+	
+	if (mFile.fail())
+		ThrowException("ChunkedTrajectoryReader::ReadIndex : truncated index");
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::ScanChunks()
+{
+	// complete chunks from the start of the data, a torn last chunk is ignored, and so
+	// is a block of times with some of its chunks missing
+	mIndex.clear();
+	mNumTimesWritten = 0;
+	
+	long long offset = mDataOffset;
+	while (offset + CHUNK_HEADER_SIZE <= mFileSize) {
+		uint32_t word[2];
+		int64_t size[6];
+		
+		mFile.seekg(offset, ios::beg);
+		mFile.read((char *) word, sizeof(word));
+		mFile.read((char *) size, sizeof(size));
+		
+		if (mFile.fail() || word[0] != CHUNK_TAG || offset + CHUNK_HEADER_SIZE + size[5] > mFileSize)
+			break;
+		
+		ChunkIndexEntry entry;
+		entry.mFirstTime = size[0];
+		entry.mNumTimes = size[1];
+		entry.mFirstMode = size[2];
+		entry.mNumModes = size[3];
+		entry.mOffset = offset;
+		mIndex.push_back(entry);
+		
+		// the block is complete with its last mode
+		if (entry.mFirstMode + entry.mNumModes == mNumModes)
+			mNumTimesWritten = entry.mFirstTime + entry.mNumTimes;
+		
+		offset += CHUNK_HEADER_SIZE + size[5];
+	}
+	
+	mFile.clear();
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::LoadChunk(long chunk)
+{
+	if (chunk == mLoadedChunk)
+		return;
+	
+	uint32_t word[2];
+	int64_t size[6];
+	
+	mFile.seekg(mIndex[chunk].mOffset, ios::beg);
+	mFile.read((char *) word, sizeof(word));
+	mFile.read((char *) size, sizeof(size));
+	
+	if (mFile.fail() || word[0] != CHUNK_TAG)
+		ThrowException("ChunkedTrajectoryReader::LoadChunk : bad chunk header");
+	
+	long long rawBytes = size[4];
+	long long storedBytes = size[5];
+	long numValues = rawBytes / sizeof(double);
+	
+	if (numValues > mRaw.Size())
+		ThrowException("ChunkedTrajectoryReader::LoadChunk : chunk larger than the header allows");
+	
+	if (mStored.Size() < storedBytes)
+		mStored.SetSize(storedBytes);
+	
+	mFile.read(mStored.Begin(), storedBytes);
+	if (mFile.fail())
+		ThrowException("ChunkedTrajectoryReader::LoadChunk : truncated chunk");
+	
+	ChunkCodec codec = (ChunkCodec) word[1];
+	if (codec == NO_CHUNK_CODEC) {
+		Decompress(codec, mStored.Begin(), storedBytes, (char *) mRaw.Begin(), rawBytes);
+	}
+	else {
+		Decompress(codec, mStored.Begin(), storedBytes, mShuffled.Begin(), rawBytes);
+		Unshuffle(mShuffled.Begin(), (char *) mRaw.Begin(), numValues);
+	}
+	
+	mLoadedChunk = chunk;
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::ReadMode(long mode, Array<double> &value)
+{
+	if (mode < 0 || mode >= mNumModes)
+		ThrowException("ChunkedTrajectoryReader::ReadMode : mode out of range");
+	
+	value.SetSize(mNumTimesWritten * mNumSystems);
+	
+	for (size_t c = 0; c < mIndex.size(); ++c) {
+		const ChunkIndexEntry &entry = mIndex[c];
+		if (mode < entry.mFirstMode || mode >= entry.mFirstMode + entry.mNumModes)
+			continue;
+		
+		if (entry.mFirstTime + entry.mNumTimes > mNumTimesWritten)
+			continue;
+		
+		LoadChunk(c);
+		
+		long numValues = entry.mNumTimes * mNumSystems;
+		const double *source = mRaw.Begin() + (mode - entry.mFirstMode) * numValues;
+		double *destination = value.Begin() + entry.mFirstTime * mNumSystems;
+		
+		for (long i = 0; i < numValues; ++i)
+			destination[i] = source[i];
+	}
+	
+	return;
+}
+
+
+
+void ChunkedTrajectoryReader::Read(long n, long system, Array<double> &mode)
+{
+	if (n < 0 || n >= mNumTimesWritten || system < 0 || system >= mNumSystems)
+		ThrowException("ChunkedTrajectoryReader::Read : record out of range");
+	
+	mode.SetSize(mNumModes);
+	
+	for (size_t c = 0; c < mIndex.size(); ++c) {
+		const ChunkIndexEntry &entry = mIndex[c];
+		if (n < entry.mFirstTime || n >= entry.mFirstTime + entry.mNumTimes)
+			continue;
+		
+		LoadChunk(c);
+		
+		long time = n - entry.mFirstTime;
+		for (long i = 0; i < entry.mNumModes; ++i)
+			mode[entry.mFirstMode + i] = mRaw[(i * entry.mNumTimes + time) * mNumSystems + system];
+	}
+	
+	return;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "controlvariatestatistics.h"
+#include "opbeconst.h"
+
+#include <math.h>
+
+using namespace NAMESPACE;
+using namespace std;
+
+void ControlVariateStatistics::Initialize(long size, long numControls)
+{
+	if (size < 0 || numControls < 0)
+		ThrowException("ControlVariateStatistics::Initialize : negative size or number of controls");
+	
+	mSize = size;
+	mNumControls = numControls;
+	
+	long m = numControls + 1;
+	mMean.SetSize(size * m);
+	mComoment.SetSize(size * m * m);
+	Reset();
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::Reset()
+{
+	mCount = 0;
+	
+	for (long i = 0; i < mMean.Size(); ++i)
+		mMean[i] = 0.0;
+	
+	for (long i = 0; i < mComoment.Size(); ++i)
+		mComoment[i] = 0.0;
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::Add(const Array<double> &sample, const Array<double> &control)
+{
+	if (sample.Size() != mSize || control.Size() != mSize * mNumControls)
+		ThrowException("ControlVariateStatistics::Add : sample or controls have wrong size");
+	
+	++mCount;
+	double f = 1.0 / mCount;
+	
+	long m = mNumControls + 1;
+	Array<double> delta(m), x(m);
+	
+	for (long i = 0; i < mSize; ++i) {
+		double *mean = mMean.Begin() + i * m;
+		double *comoment = mComoment.Begin() + i * m * m;
+		
+		x[0] = sample[i];
+		for (long c = 0; c < mNumControls; ++c)
+			x[c + 1] = control[i * mNumControls + c];
+		
+		for (long a = 0; a < m; ++a) {
+			delta[a] = x[a] - mean[a];
+			mean[a] += f * delta[a];
+		}
+		
+		// delta (x - new mean)^T
+		for (long a = 0; a < m; ++a) {
+			for (long b = 0; b < m; ++b)
+				comoment[a * m + b] += delta[a] * (x[b] - mean[b]);
+		}
+	}
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::Merge(const ControlVariateStatistics &statistics)
+{
+	if (statistics.mCount == 0)
+		return;
+	
+	if (statistics.mSize != mSize || statistics.mNumControls != mNumControls)
+		ThrowException("ControlVariateStatistics::Merge : accumulators have different sizes");
+	
+	long count = mCount + statistics.mCount;
+	double f = (double) statistics.mCount / count;
+	double g = (double) mCount * f;
+	
+	long m = mNumControls + 1;
+	Array<double> delta(m);
+	
+	for (long i = 0; i < mSize; ++i) {
+		double *mean = mMean.Begin() + i * m;
+		double *comoment = mComoment.Begin() + i * m * m;
+		const double *otherMean = statistics.mMean.Begin() + i * m;
+		const double *otherComoment = statistics.mComoment.Begin() + i * m * m;
+		
+		for (long a = 0; a < m; ++a) {
+			delta[a] = otherMean[a] - mean[a];
+			mean[a] += f * delta[a];
+		}
+		
+		for (long a = 0; a < m; ++a) {
+			for (long b = 0; b < m; ++b)
+				comoment[a * m + b] += otherComoment[a * m + b] + g * delta[a] * delta[b];
+		}
+	}
+	
+	mCount = count;
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::Means(Array<double> &mean) const
+{
+	// the plain means of the samples, without the controls
+	mean.SetSize(mSize);
+	for (long i = 0; i < mSize; ++i)
+		mean[i] = Mean(i);
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::Coefficients(long i, Array<double> &beta) const
+{
+	// solve Cov(c, c) beta = Cov(c, f) by gaussian elimination with partial pivoting. a
+	// control that is (nearly) a combination of the others, or constant, gets no weight
+	long q = mNumControls;
+	long m = q + 1;
+	const double *comoment = mComoment.Begin() + i * m * m;
+	
+	Array<double> a(q * q), b(q);
+	Array<long> column(q);
+	
+	double scale = 0.0;
+	for (long r = 0; r < q; ++r) {
+		for (long c = 0; c < q; ++c)
+			a[r * q + c] = comoment[(r + 1) * m + c + 1];
+		
+		b[r] = comoment[(r + 1) * m];
+		scale = max(scale, a[r * q + r]);
+	}
+	
+	for (long r = 0; r < q; ++r)
+		column[r] = -1;
+	
+	beta.SetSize(q);
+	for (long c = 0; c < q; ++c)
+		beta[c] = 0.0;
+	
+	if (mCount < 2 || scale <= 0.0)
+		return;
+	
+	// eliminate column by column, skipping the degenerate ones
+	long rank = 0;
+	for (long c = 0; c < q && rank < q; ++c) {
+		long pivot = rank;
+		for (long r = rank + 1; r < q; ++r) {
+			if (fabs(a[r * q + c]) > fabs(a[pivot * q + c]))
+				pivot = r;
+		}
+		
+		if (fabs(a[pivot * q + c]) <= CONTROL_VARIATE_PIVOT_TOLERANCE * scale)
+			continue;
+		
+		if (pivot != rank) {
+			for (long k = 0; k < q; ++k)
+				swap(a[pivot * q + k], a[rank * q + k]);
+			
+			swap(b[pivot], b[rank]);
+		}
+		
+		for (long r = rank + 1; r < q; ++r) {
+			double factor = a[r * q + c] / a[rank * q + c];
+			for (long k = c; k < q; ++k)
+				a[r * q + k] -= factor * a[rank * q + k];
+			
+			b[r] -= factor * b[rank];
+		}
+		
+		column[rank] = c;
+		++rank;
+	}
+	
+	// back substitution on the pivot columns
+	for (long r = rank - 1; r >= 0; --r) {
+		long c = column[r];
+		
+		double sum = b[r];
+		for (long k = r + 1; k < rank; ++k)
+			sum -= a[r * q + column[k]] * beta[column[k]];
+		
+		beta[c] = sum / a[r * q + c];
+	}
+	
+	return;
+}
+
+
+
+double ControlVariateStatistics::Estimate(long i, const double controlMean[]) const
+{
+	long m = mNumControls + 1;
+	const double *mean = mMean.Begin() + i * m;
+	
+	Array<double> beta;
+	Coefficients(i, beta);
+	
+	double estimate = mean[0];
+	for (long c = 0; c < mNumControls; ++c)
+		estimate -= beta[c] * (mean[c + 1] - controlMean[c]);
+	
+	return estimate;
+}
+
+
+
+double ControlVariateStatistics::VarianceRatio(long i) const
+{
+	// variance of f - beta^T c over the variance of f, i.e. 1 - R^2
+	long m = mNumControls + 1;
+	const double *comoment = mComoment.Begin() + i * m * m;
+	
+	if (comoment[0] <= 0.0)
+		return 1.0;
+	
+	Array<double> beta;
+	Coefficients(i, beta);
+	
+	double explained = 0.0;
+	for (long c = 0; c < mNumControls; ++c)
+		explained += beta[c] * comoment[(c + 1) * m];
+	
+	return max(0.0, 1.0 - explained / comoment[0]);
+}
+
+
+
+double ControlVariateStatistics::StandardError(long i) const
+{
+	// of the control variate estimate, sqrt((1 - R^2) Var(f) / n)
+	if (mCount < 2)
+		return 0.0;
+	
+	return sqrt(Variance(i) * VarianceRatio(i) / mCount);
+}
+
+
+
+void ControlVariateStatistics::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	checkpoint.WriteInteger(mCount);
+	checkpoint.WriteInteger(mNumControls);
+	checkpoint.WriteArray(mMean);
+	checkpoint.WriteArray(mComoment);
+	
+	return;
+}
+
+
+
+void ControlVariateStatistics::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	long count = checkpoint.ReadInteger();
+	long numControls = checkpoint.ReadInteger();
+	
+	Array<double> mean, comoment;
+	checkpoint.ReadArray(mean);
+	checkpoint.ReadArray(comoment);
+	
+	if (count < 0 || numControls != mNumControls || mean.Size() != mMean.Size() || comoment.Size() != mComoment.Size())
+		ThrowException("ControlVariateStatistics::ReadCheckpoint : checkpoint doesn't match the accumulator");
+	
+	mCount = count;
+	mMean = mean;
+	mComoment = comoment;
+	
+	return;
+}
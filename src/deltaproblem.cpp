@@ -56,7 +56,8 @@ void DeltaProblem::Run(const string &fileName)
 	
 	clock.StopAndPrintTime();
 	
-	mSystem[0].CleanUpSolver();
+	for (short i = 0; i < mSystem.Size(); ++i)
+		mSystem[i].CleanUpSolver();
 	
 	
     return;
@@ -76,6 +77,7 @@ void DeltaProblem::Run()
 		WriteVolterraFFile();
 	}		
 	
+	FinishOutput();
 		
 	mRunControl.SetState(SYSTEM_STOP);
 	
@@ -110,7 +112,8 @@ void DeltaProblem::Initialize()
 	mSystem[2].SetInitialCondition(1, mDeltaX2);
 	
 	// initialize all systems
-	mSystem[0].InitializeSolver();
+	for (short i = 0; i < 3; ++i)
+		mSystem[i].InitializeSolver();
 	
 
 	return;
@@ -23,6 +23,8 @@
 #include "density.h"
 #include <iostream>
 
+#include <gsl/gsl_cdf.h>
+
 using namespace NAMESPACE;
 using namespace std;
 
@@ -107,6 +109,37 @@ void Density::OneDGaussianDomain(double epsilon, double &min, double &max) const
 
 
 
+double Density::InverseCDF(double u) const
+{
+	switch (mType) {
+	case NO_DENSITY_TYPE:
+		ThrowException("Density::InverseCDF : unspecified function type");
+		break;
+			
+	case ONE_DIMENSIONAL_GAUSSIAN:
+		return OneDGaussianInverseCDF(u);
+		break;
+        
+	default:
+		ThrowException("Density::InverseCDF : unspecified function type");
+		break;
+	}
+	
+	return 0.0;
+}
+
+
+
+double Density::OneDGaussianInverseCDF(double u) const
+{
+	if (u <= 0.0 || u >= 1.0)
+		ThrowException("Density::GaussianInverseCDF : argument not in (0, 1)");
+	
+	return mParameter[0] + gsl_cdf_gaussian_Pinv(u, mParameter[1]);
+}
+
+
+
 short Density::GetModeIndex() const
 {
 	switch (mType) {
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <ctime>
 
 using namespace NAMESPACE;
 using namespace std;
@@ -43,12 +44,22 @@ void FixedICProblem::Run(const string &fileName)
 	// read input file
     ReadInputFile(fileName);
 	
+	// or only time the right hand sides and the solvers
+	if (mRunControl.BenchmarkOn()) {
+		Benchmark();
+		return;
+	}
+	
 	// set initial conditions
 	Initialize();
 	Reset();
 	
 	mState = PROBLEM_START;
 	mRunControl.SetState(SYSTEM_RUN);
+	
+	// or continue from a checkpoint, and the binary mode file of the run it restarts
+	long firstOutputTime = RestoreCheckpoint();
+	mNumOutputTimesWritten = firstOutputTime;
 
 	Clock clock;
 	if (mRunControl.RunClockOn()) {
@@ -56,11 +67,16 @@ void FixedICProblem::Run(const string &fileName)
 		clock.Start();
 	}
 		
-	for (long i = 0; i < mRunControl.NumOutputTimes(); ++i) {
+	for (long i = firstOutputTime; i < mRunControl.NumOutputTimes(); ++i) {
 		Evolve(mRunControl.OutputTime(i));
 		WriteOutput();
+		
+		if (CheckpointDue())
+			SaveCheckpoint(i + 1);
 	}
 	
+	FinishOutput();
+	
 	clock.StopAndPrintTime();
 	
 	mState = PROBLEM_DONE;
@@ -105,3 +121,97 @@ void FixedICProblem::ReadInputFile(const string &fileName)
 	
 	return;
 }
+
+
+
+void FixedICProblem::Test(const string &fileName)
+{
+	ReadInputFile(fileName);
+	Benchmark();
+	
+	return;
+}
+
+
+
+void FixedICProblem::Benchmark()
+{
+	// benchmark of the right hand side evaluation methods at several mode counts,
+	// using the viscosity and t-model setting of the input file, then of the solvers
+	const short numSizes = 6;
+	long numModes[numSizes] = {16, 32, 64, 128, 256, 1024};
+	
+	for (short n = 0; n < numSizes; ++n) {
+		System system;
+		system.SetRunControl(&mRunControl);
+		system.SetModeIndex(&mModeIndex);
+		system.SetNumModes(numModes[n]);
+		system.SetOPBEParameter(&mOPBEParameter);
+		system.SetCurrentTime(1.0);
+		
+		for (long k = 0; k < numModes[n]; ++k)
+			system.SetInitialCondition(k, 1.0 / (k + 1.0));
+		
+		system.SetToInitialCondition();
+		system.BenchmarkRHS(RHS_BENCHMARK_NUM_EVALUATIONS);
+	}
+	
+	BenchmarkSolvers();
+	
+	
+	return;
+}
+
+
+
+void FixedICProblem::BenchmarkSolvers()
+{
+	// times the evolution of the initial conditions from the start to the end time with
+	// several steppers, the first (rk8pd) is the reference. etdrk4 uses the fixed time step
+	const short numSolvers = 7;
+	string solverName[numSolvers] = {"rk8pd", "rkf45", "rkck", "dopri5", "etdrk4", "sdirk2", "ark43"};
+	
+	string inputSolverName = mRunControl.SolverName();
+	Array<double> reference;
+	
+	cout << "numModes = " << mNumModes << ", t = " << mRunControl.StartTime() << " to " << mRunControl.EndTime() << endl;
+	
+	for (short i = 0; i < numSolvers; ++i) {
+		mRunControl.SetGSLSolverName(solverName[i]);
+		mRunControl.SetState(SYSTEM_INITIALIZE);
+		
+		System system;
+		system.SetRunControl(&mRunControl);
+		system.SetModeIndex(&mModeIndex);
+		system.SetNumModes(mNumModes);
+		system.SetOPBEParameter(&mOPBEParameter);
+		system.SetCurrentTime(mRunControl.StartTime());
+		system.SetInitialConditions(mInitialCondition);
+		system.InitializeSolver();
+		system.SetToInitialCondition();
+		
+		mRunControl.SetState(SYSTEM_RUN);
+		
+		clock_t start = clock();
+		system.Evolve(mRunControl.EndTime());
+		double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+		
+		mRunControl.SetState(SYSTEM_STOP);
+		system.CleanUpSolver();
+		
+		if (i == 0)
+			reference = system.Modes();
+		
+		double error = 0.0;
+		for (long k = 0; k < mNumModes; ++k)
+			error = max(error, fabs(system.GetMode(k) - reference[k]));
+		
+		cout << "  " << solverName[i] << " : " << seconds << " seconds, ";
+		cout << "max difference from rk8pd = " << error << endl;
+	}
+	
+	mRunControl.SetGSLSolverName(inputSolverName);
+	
+	
+	return;
+}
@@ -18,9 +18,12 @@
 */
 
 #include "system.h"
+#include "integrator.h"
 #include "modeindex.h"
 
+#include <algorithm>
 #include <iostream>
+#include <ctime>
 
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
@@ -29,125 +32,33 @@
 using namespace NAMESPACE;
 using namespace std;
 
-// struct for passing parameters to TimeDerivative
-struct gsl_parameters {
-	double mEpsilon;
-	bool mTModelOn;
-	long mNumModes;
-	SystemType mSystemType;
-};
+int BurgersEquationFFT(double t, const double u[], double uDot[], RHSParameters *pParams);
+void BurgersTModel(double t, const double u[], double uDot[], RHSParameters *pParams);
+void BurgersTModelFFT(double t, const double u[], double uDot[], RHSParameters *pParams);
+int BurgersEquationSIMD(double t, const double u[], double uDot[], RHSParameters *pParams);
+int NavierStokes(double t, const double u[], double uDot[], RHSParameters *pParams);
+int BurgersJacobian(double t, const double u[], double *dfdy, double dfdt[], RHSParameters *pParams);
+void BurgersTModelJacobian(double t, const double u[], double *dfdy, double dfdt[], RHSParameters *pParams);
 
-// global variables for this file
-ModeIndex modeIndex;
-double *y;
-
-int TimeDerivative(double t, const double u[], double uDot[], void *params);
-int BurgersEquation(double t, const double u[], double uDot[], gsl_parameters *pParams);
-int NavierStokes(double t, const double u[], double uDot[], gsl_parameters *pParams);
-
-inline double U(long i, const double u[]) {return u[modeIndex(i)];}
-inline double U(long i, long j, long k, const double u[]) {return u[modeIndex(i, j, k)];}
+inline double U(long i, const double u[], const ModeIndex &modeIndex) {return u[modeIndex(i)];}
+inline double U(long i, long j, long k, const double u[], const ModeIndex &modeIndex) {return u[modeIndex(i, j, k)];}
 
 void System::GSLEvolve(double t1)
 {
-	// note: static variables here are shared among all instances of System
-	static gsl_parameters params;
-	static const gsl_odeiv_step_type *pStepType = NULL;
-	static gsl_odeiv_step *pStepAlloc = NULL;
-	static gsl_odeiv_control *pStepControl = NULL;
-	static gsl_odeiv_evolve *pEvolve = NULL;
-	static Array<double> yArray;
-	static double h;
-		
 	// initialize if first call
 	if (mpRunControl->State() == SYSTEM_INITIALIZE) {
-		params.mEpsilon = mpOPBEParameter->ViscosityCoefficient();
-		params.mTModelOn = mpRunControl->TModelOn();
-		params.mNumModes = mMode.Size();
-		params.mSystemType = mpRunControl->GetSystemType();
-		
-		// solver
-		string solverName = mpRunControl->SolverName();
-		if (solverName == "rk2")
-			pStepType = gsl_odeiv_step_rk2;
-			
-		if (solverName == "rk4")
-			pStepType = gsl_odeiv_step_rk4;
-		
-		if (solverName == "rkf45")
-			pStepType = gsl_odeiv_step_rkf45;
-		
-		if (solverName == "rkck")
-			pStepType = gsl_odeiv_step_rkck;
-		
-		if (solverName == "rk8pd")
-			pStepType = gsl_odeiv_step_rk8pd;
-		
-		if (solverName == "rk2imp")
-			pStepType = gsl_odeiv_step_rk2imp;
-		
-		if (solverName == "rk4imp")
-			pStepType = gsl_odeiv_step_rk4imp;
-		
-		if (solverName == "bsimp")
-			pStepType = gsl_odeiv_step_bsimp;
-		
-		if (solverName == "gear1")
-			pStepType = gsl_odeiv_step_gear1;
-			
-		if (solverName == "gear2")
-			pStepType = gsl_odeiv_step_gear2;
-			
-		if (pStepType == NULL)
-			ThrowException("System::GSLEvolve : invalid gsl solver name: " + solverName);
-		else
-			pStepAlloc = gsl_odeiv_step_alloc(pStepType, mMode.Size());
-	
-		// step control
-		double localAbsoluteError = mpRunControl->GetLocalAbsoluteError();
-		double localRelativeError = mpRunControl->GetLocalRelativeError();
-		pStepControl = gsl_odeiv_control_y_new(localAbsoluteError, localRelativeError);
-	
-		// evolver
-		pEvolve = gsl_odeiv_evolve_alloc(mMode.Size());
-		
-		h = DEFAULT_TIME_STEP;
-		
-		modeIndex = *mpModeIndex;
-					
+		mIntegrator.Initialize(*mpRunControl, *mpOPBEParameter, *mpModeIndex, mMode.Size());
 		return;
 	}
 	
 	// clean up if done
 	if (mpRunControl->State() == SYSTEM_STOP) {
-		pStepType = NULL;
-		
-		gsl_odeiv_evolve_free(pEvolve);
-		pEvolve = NULL;
-		
-		gsl_odeiv_control_free(pStepControl);
-		pStepControl = NULL;
-		
-		gsl_odeiv_step_free(pStepAlloc);
-		pStepAlloc = NULL;
-		
+		mIntegrator.CleanUp();
 		return;
 	}
 	
-	//gsl_odeiv_system system = {TimeDerivative, Jacobian, mNumModes, &params};
-	gsl_odeiv_system system = {TimeDerivative, NULL, params.mNumModes, &params};
-		
 	double t = mCurrentTime;
-	//double *y = mMode.Begin();
-	y = mMode.Begin();
-	
-	// call ode solver
-	while (t < t1) {
-		int status = gsl_odeiv_evolve_apply(pEvolve, pStepControl, pStepAlloc, &system, &t, t1, &h, y);
-	
-		if (status != GSL_SUCCESS) 
-			ThrowException("System::GSLEvolve : gsl step unsuccessful, gsl_status = " + status);
-	}
+	mIntegrator.Evolve(t, t1, mMode.Begin());
 	
 	// update current time
 	mCurrentTime = t;
@@ -157,9 +68,9 @@ void System::GSLEvolve(double t1)
 
 	
 	
-int TimeDerivative(double t, const double u[], double uDot[], void *params)
+int NAMESPACE::TimeDerivative(double t, const double u[], double uDot[], void *params)
 {
-	gsl_parameters *pParams = (gsl_parameters *) params;
+	RHSParameters *pParams = (RHSParameters *) params;
 	
 	switch (pParams->mSystemType) {
 	case BURGERS_EQUATION:
@@ -180,56 +91,320 @@ int TimeDerivative(double t, const double u[], double uDot[], void *params)
 
 
 
-int BurgersEquation(double t, const double u[], double uDot[], gsl_parameters *pParams)
+int NAMESPACE::Jacobian(double t, const double u[], double *dfdy, double dfdt[], void *params)
+{
+	RHSParameters *pParams = (RHSParameters *) params;
+	
+	switch (pParams->mSystemType) {
+	case BURGERS_EQUATION:
+		return BurgersJacobian(t, u, dfdy, dfdt, pParams);
+		break;
+	
+	default:
+		ThrowException("Jacobian : only implemented for Burgers equation");
+		return GSL_FAILURE;
+		break;
+	}
+}
+
+
+
+int NAMESPACE::BurgersEquation(double t, const double u[], double uDot[], RHSParameters *pParams)
 {
-	static Array<double> work;
+	if (pParams->mRHSMethod == FFT_RHS)
+		return BurgersEquationFFT(t, u, uDot, pParams);
+	
+	if (pParams->mRHSMethod == SIMD_RHS)
+		return BurgersEquationSIMD(t, u, uDot, pParams);
+	
+	// compile-time specialization for this number of modes, if there is one
+	if (pParams->mpFixedSize != NULL) {
+		pParams->mpFixedSize(t, pParams->mEpsilon, u, uDot);
+		return GSL_SUCCESS;
+	}
 	
 	double epsilon = pParams->mEpsilon;
 	long numModes = pParams->mNumModes;
-	bool tModelOn = pParams->mTModelOn;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
 			
 	double sum1 = 0.0, sum2 = 0.0;
 
 	for (long k = 1; k <= numModes; ++k) {
-		double viscosityTerm = -epsilon * k * k * U(k, u);
+		double viscosityTerm = -epsilon * k * k * U(k, u, modeIndex);
 
 		sum1 = 0.0;
 		for (long kp = 1; kp <= numModes - k; ++kp) 
-			sum1 += U(kp, u) * U(kp + k, u);
+			sum1 += U(kp, u, modeIndex) * U(kp + k, u, modeIndex);
 		
 		sum2 = 0.0;
 		for (long kp = 1; kp <= k - 1; ++kp)
-			sum2 += kp * U(kp, u) * U(k - kp, u);
+			sum2 += kp * U(kp, u, modeIndex) * U(k - kp, u, modeIndex);
 		
 		uDot[modeIndex(k)] = viscosityTerm + 0.5 * (k * sum1 - sum2);
 	}
 	
-	if (tModelOn) {
-		if (work.Empty())
-			work.SetSize(numModes + 1);
+	if (pParams->mTModelOn)
+		BurgersTModel(t, u, uDot, pParams);
+	
+	
+	return GSL_SUCCESS;
+}
+
+
+
+int BurgersEquationFFT(double t, const double u[], double uDot[], RHSParameters *pParams)
+{
+	// same equation as BurgersEquation, but sum1 and sum2 come from the fft. by symmetry
+	// sum_{kp < k} kp U(kp) U(k - kp) = (k / 2) * convolution(k)
+	
+	BurgersFFT *pFFT = &pParams->mFFT;
+	if (pFFT->Ready() == false || pFFT->NumModes() != pParams->mNumModes)
+		ThrowException("BurgersEquationFFT : fft not initialized");
+	
+	double epsilon = pParams->mEpsilon;
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	pFFT->ComputeSums(u);
+	
+	for (long k = 1; k <= numModes; ++k) {
+		double viscosityTerm = -epsilon * k * k * U(k, u, modeIndex);
+		
+		double sum1 = pFFT->Correlation(k);
+		double sum2 = 0.5 * k * pFFT->Convolution(k);
+		
+		uDot[modeIndex(k)] = viscosityTerm + 0.5 * (k * sum1 - sum2);
+	}
+	
+	if (pParams->mTModelOn)
+		BurgersTModelFFT(t, u, uDot, pParams);
+	
+	
+	return GSL_SUCCESS;
+}
+
+
+
+void BurgersTModelFFT(double t, const double u[], double uDot[], RHSParameters *pParams)
+{
+	// same as BurgersTModel, reusing the transform of u from BurgersEquationFFT
+	BurgersFFT *pFFT = &pParams->mFFT;
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	pFFT->ComputeTModelSums();
+	
+	for (long m = 1; m <= numModes; ++m) 
+		uDot[modeIndex(m)] += -0.25 * t * m * pFFT->TModelSum(m);
+	
+	return;
+}
+
+
+
+int BurgersEquationSIMD(double t, const double u[], double uDot[], RHSParameters *pParams)
+{
+	// same equation as BurgersEquation, with the kp loops done as contiguous dot products
+	BurgersKernel *pKernel = &pParams->mKernel;
+	if (pKernel->NumModes() != pParams->mNumModes)
+		ThrowException("BurgersEquationSIMD : kernel not initialized");
+	
+	double epsilon = pParams->mEpsilon;
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	pKernel->ComputeSums(u);
+	
+	for (long k = 1; k <= numModes; ++k) {
+		double viscosityTerm = -epsilon * k * k * U(k, u, modeIndex);
+		uDot[modeIndex(k)] = viscosityTerm + 0.5 * (k * pKernel->Sum1(k) - pKernel->Sum2(k));
+	}
+	
+	if (pParams->mTModelOn) {
+		pKernel->ComputeTModelSums();
+		
+		for (long m = 1; m <= numModes; ++m) 
+			uDot[modeIndex(m)] += -0.25 * t * m * pKernel->TModelSum(m);
+	}
+	
+	
+	return GSL_SUCCESS;
+}
+
+
+
+void BurgersTModel(double t, const double u[], double uDot[], RHSParameters *pParams)
+{
+	Array<double> &work = pParams->mWork;
+	
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	if (work.Size() != numModes + 1)
+		work.SetSize(numModes + 1);
+	
+	for (long mpp = 1; mpp <= numModes; ++mpp) {
+		work[mpp] = 0.0;
+		for (long mp = mpp; mp <= numModes; ++mp) 
+			work[mpp] += (mpp + numModes - mp) * U(mp, u, modeIndex) * U(mpp + numModes - mp, u, modeIndex);
+	}
+	
+	for (long m = 1; m <= numModes; ++m) {
+		double sum1 = 0.0;
+		for (long mpp = 1; mpp <= m; ++mpp) 
+			sum1 += work[mpp] * U(mpp + numModes - m, u, modeIndex);
+		
+		uDot[modeIndex(m)] += -0.25 * t * m * sum1;
+	}
+	
+	return;
+}
+
+
+
+int BurgersJacobian(double t, const double u[], double *dfdy, double dfdt[], RHSParameters *pParams)
+{
+	// dfdy[i N + j] = d uDot_i / d u_j, row-major as gsl wants it. differentiating the sums
+	// in BurgersEquation, the quadratic term gives a Toeplitz (u_{j - k}, u_{k - j}) plus
+	// Hankel (u_{j + k}) matrix
+	//
+	// J_kj = -epsilon k^2 delta_kj + 0.5 k (u_{j + k} [j + k <= N] + u_{j - k} [j > k] - u_{k - j} [j < k])
+	
+	double epsilon = pParams->mEpsilon;
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	for (long k = 1; k <= numModes; ++k) {
+		double *row = dfdy + modeIndex(k) * numModes;
+		double f = 0.5 * k;
 		
-		for (long mpp = 1; mpp <= numModes; ++mpp) {
-			work[mpp] = 0.0;
-			for (long mp = mpp; mp <= numModes; ++mp) 
-				work[mpp] += (mpp + numModes - mp) * U(mp, u) * U(mpp + numModes - mp, u);
+		for (long j = 1; j <= numModes; ++j) {
+			double value = 0.0;
+			
+			if (j + k <= numModes)
+				value += U(j + k, u, modeIndex);
+			
+			if (j > k)
+				value += U(j - k, u, modeIndex);
+			
+			if (j < k)
+				value -= U(k - j, u, modeIndex);
+			
+			row[modeIndex(j)] = f * value;
 		}
 		
+		row[modeIndex(k)] -= epsilon * k * k;
+		
+		dfdt[modeIndex(k)] = 0.0;
+	}
+	
+	if (pParams->mTModelOn)
+		BurgersTModelJacobian(t, u, dfdy, dfdt, pParams);
+	
+	return GSL_SUCCESS;
+}
+
+
+
+void BurgersTModelJacobian(double t, const double u[], double *dfdy, double dfdt[], RHSParameters *pParams)
+{
+	// the t-model term is -0.25 t m T_m with T_m = sum_{j = 1}^{m} work_j u_{j + N - m} and
+	// work_j as in BurgersTModel. since d work_j / d u_q = (j + N) u_{j + N - q} for j <= q,
+	//
+	// d T_m / d u_q = A(q, m) + work_{q - N + m} [q > N - m]
+	//
+	// A(q, m) = sum_{j = 1}^{min(q, m)} (j + N) u_{j + N - q} u_{j + N - m}
+	// H(q, m) = sum_{j = 1}^{min(q, m)} u_{j + N - q} u_{j + N - m}
+	//
+	// and shifting j by one gives the O(N^2) recurrences (zero when q or m is zero)
+	//
+	// H(q, m) = H(q - 1, m - 1) + u_{N + 1 - q} u_{N + 1 - m}
+	// A(q, m) = A(q - 1, m - 1) + H(q - 1, m - 1) + (N + 1) u_{N + 1 - q} u_{N + 1 - m}
+	//
+	// the term is linear in t, so dfdt is the term divided by t
+	long numModes = pParams->mNumModes;
+	const ModeIndex &modeIndex = pParams->mModeIndex;
+	
+	Array<double> &work = pParams->mWork;
+	if (work.Size() != numModes + 1)
+		work.SetSize(numModes + 1);
+	
+	for (long mpp = 1; mpp <= numModes; ++mpp) {
+		work[mpp] = 0.0;
+		for (long mp = mpp; mp <= numModes; ++mp) 
+			work[mpp] += (mpp + numModes - mp) * U(mp, u, modeIndex) * U(mpp + numModes - mp, u, modeIndex);
+	}
+	
+	for (long m = 1; m <= numModes; ++m) {
+		double sum1 = 0.0;
+		for (long mpp = 1; mpp <= m; ++mpp) 
+			sum1 += work[mpp] * U(mpp + numModes - m, u, modeIndex);
+		
+		dfdt[modeIndex(m)] += -0.25 * m * sum1;
+	}
+	
+	// rows q - 1 and q of H and A
+	Array<double> &jacobianWork = pParams->mJacobianWork;
+	if (jacobianWork.Size() != 4 * (numModes + 1))
+		jacobianWork.SetSize(4 * (numModes + 1));
+	
+	double *hPrevious = jacobianWork.Begin();
+	double *aPrevious = hPrevious + numModes + 1;
+	double *h = aPrevious + numModes + 1;
+	double *a = h + numModes + 1;
+	
+	for (long m = 0; m <= numModes; ++m) {
+		hPrevious[m] = 0.0;
+		aPrevious[m] = 0.0;
+	}
+	
+	h[0] = 0.0;
+	a[0] = 0.0;
+	
+	for (long q = 1; q <= numModes; ++q) {
+		double uq = U(numModes + 1 - q, u, modeIndex);
+		
 		for (long m = 1; m <= numModes; ++m) {
-			sum1 = 0.0;
-			for (long mpp = 1; mpp <= m; ++mpp) 
-				sum1 += work[mpp] * U(mpp + numModes - m, u);
+			double product = uq * U(numModes + 1 - m, u, modeIndex);
+			h[m] = hPrevious[m - 1] + product;
+			a[m] = aPrevious[m - 1] + hPrevious[m - 1] + (numModes + 1) * product;
+			
+			double dTdu = a[m];
+			if (q > numModes - m)
+				dTdu += work[q - numModes + m];
 			
-			uDot[modeIndex(m)] += -0.25 * t * m * sum1;
+			dfdy[modeIndex(m) * numModes + modeIndex(q)] += -0.25 * t * m * dTdu;
 		}
+		
+		swap(h, hPrevious);
+		swap(a, aPrevious);
 	}
 	
+	return;
+}
+
+
+
+void NAMESPACE::InitializeRHSWorkspace(RHSParameters &params)
+{
+	// params.mNumModes, params.mTModelOn and params.mRHSMethod must already be set
+	params.mpFixedSize = NULL;
 	
-	return GSL_SUCCESS;
+	if (params.mRHSMethod == DIRECT_RHS)
+		params.mpFixedSize = FixedSizeBurgersEquation(params.mNumModes, params.mTModelOn);
+	
+	if (params.mRHSMethod == FFT_RHS)
+		params.mFFT.Initialize(params.mNumModes);
+	
+	if (params.mRHSMethod == SIMD_RHS)
+		params.mKernel.Initialize(params.mNumModes);
+	
+	return;
 }
 
 
 
-int NavierStokes(double t, const double u[], double uDot[], gsl_parameters *pParams)
+int NavierStokes(double t, const double u[], double uDot[], RHSParameters *pParams)
 {
 
 
@@ -238,13 +413,33 @@ int NavierStokes(double t, const double u[], double uDot[], gsl_parameters *pPar
 
 
 
-void System::RHS(Array<double> &rhs) const
+RHSParameters &System::RHSWorkspace(bool tModelOn) const
 {
-	gsl_parameters params;
+	// the workspaces are only set up again when the number of modes, the system type
+	// or the right hand side method changed since the last call
+	RHSParameters &params = mRHSWorkspace;
+	if (params.mNumModes != mMode.Size() || params.mSystemType != mpRunControl->GetSystemType() || 
+		params.mRHSMethod != mpRunControl->GetRHSMethod()) {
+		params.mNumModes = mMode.Size();
+		params.mSystemType = mpRunControl->GetSystemType();
+		params.mRHSMethod = mpRunControl->GetRHSMethod();
+		params.mTModelOn = tModelOn;
+		params.mModeIndex = *mpModeIndex;
+		InitializeRHSWorkspace(params);
+	}
+	
 	params.mEpsilon = mpOPBEParameter->ViscosityCoefficient();
-	params.mTModelOn = mpRunControl->TModelOn();
-	params.mNumModes = mMode.Size();
-	params.mSystemType = mpRunControl->GetSystemType();
+	params.mTModelOn = tModelOn;
+	params.mpFixedSize = (params.mRHSMethod == DIRECT_RHS) ? FixedSizeBurgersEquation(params.mNumModes, tModelOn) : NULL;
+	
+	return params;
+}
+
+
+
+void System::RHS(Array<double> &rhs) const
+{
+	RHSParameters &params = RHSWorkspace(mpRunControl->TModelOn());
 		
 	rhs.SetSize(mMode.Size());
 	
@@ -257,21 +452,12 @@ void System::RHS(Array<double> &rhs) const
 
 void System::RatioTModel(Array<double> &ratio) const
 {
-	gsl_parameters params;
-	params.mEpsilon = mpOPBEParameter->ViscosityCoefficient();
-	params.mTModelOn = mpRunControl->TModelOn();
-	params.mNumModes = mMode.Size();
-	params.mSystemType = mpRunControl->GetSystemType();
-		
 	ratio.SetSize(mMode.Size());
 	Array<double> rhsOff(mMode.Size());
 	Array<double> rhsOn(mMode.Size());
 	
-	params.mTModelOn = false;
-	TimeDerivative(mCurrentTime, mMode.Begin(), rhsOff.Begin(), &params);
-	
-	params.mTModelOn = true;
-	TimeDerivative(mCurrentTime, mMode.Begin(), rhsOn.Begin(), &params);
+	TimeDerivative(mCurrentTime, mMode.Begin(), rhsOff.Begin(), &RHSWorkspace(false));
+	TimeDerivative(mCurrentTime, mMode.Begin(), rhsOn.Begin(), &RHSWorkspace(true));
 	
 	for (long k = 0; k < mMode.Size(); ++k) {
 		ratio[k] = rhsOn[k];
@@ -287,3 +473,69 @@ void System::RatioTModel(Array<double> &ratio) const
 	return;
 }
 
+
+
+void System::BenchmarkRHS(long numEvaluations) const
+{
+	// times numEvaluations right hand side evaluations with each method at the current modes
+	RHSParameters params;
+	params.mEpsilon = mpOPBEParameter->ViscosityCoefficient();
+	params.mTModelOn = mpRunControl->TModelOn();
+	params.mNumModes = mMode.Size();
+	params.mSystemType = BURGERS_EQUATION;
+	params.mModeIndex = *mpModeIndex;
+	
+	Array<double> rhs(mMode.Size());
+	Array<double> reference(mMode.Size());
+	
+	// the first (reference) entry is the generic direct loop, the second the
+	// fixed-size template, when one exists for this number of modes
+	const short numMethods = 6;
+	RHSMethod method[numMethods] = {DIRECT_RHS, DIRECT_RHS, SIMD_RHS, SIMD_RHS, SIMD_RHS, FFT_RHS};
+	KernelInstructionSet instructionSet[numMethods] = {SCALAR_KERNEL, SCALAR_KERNEL, SCALAR_KERNEL, AVX2_KERNEL, AVX512_KERNEL, SCALAR_KERNEL};
+	
+	KernelInstructionSet best = BurgersKernel::BestInstructionSet();
+	
+	cout << "numModes = " << mMode.Size() << endl;
+	
+	for (short i = 0; i < numMethods; ++i) {
+		if (method[i] == SIMD_RHS && instructionSet[i] > best)
+			continue;
+		
+		params.mKernel.SetInstructionSet(instructionSet[i]);
+		params.mRHSMethod = method[i];
+		InitializeRHSWorkspace(params);
+		
+		if (i == 0)
+			params.mpFixedSize = NULL;
+		
+		if (i == 1 && params.mpFixedSize == NULL)
+			continue;
+		
+		clock_t start = clock();
+		for (long n = 0; n < numEvaluations; ++n)
+			TimeDerivative(mCurrentTime, mMode.Begin(), rhs.Begin(), &params);
+		double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+		
+		if (i == 0)
+			reference = rhs;
+		
+		double error = 0.0;
+		for (long k = 0; k < mMode.Size(); ++k)
+			error = max(error, fabs(rhs[k] - reference[k]));
+		
+		string name = "direct";
+		if (i == 1)
+			name = "direct (fixed size)";
+		if (method[i] == SIMD_RHS)
+			name = "simd (" + params.mKernel.InstructionSetName() + ")";
+		if (method[i] == FFT_RHS)
+			name = "fft";
+		
+		cout << "  " << name << " : " << 1.0e6 * seconds / numEvaluations << " microseconds per rhs, ";
+		cout << "max difference from direct = " << error << endl;
+	}
+	
+	
+	return;
+}
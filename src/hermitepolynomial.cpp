@@ -69,6 +69,85 @@ double HermitePolynomial::EvaluateStandard(double x, short n) const
 
 
 
+void HermitePolynomial::GaussQuadrature(short numPoints, Array<double> &node, Array<double> &weight) const
+{
+	// the nodes are the roots of the standard polynomial H_n, found by newton's method on the
+	// recurrence in EvaluateStandard. the recurrence is run for H_k / sqrt(2^k k! sqrt(pi)),
+	// which doesn't overflow for large n, and then H_n' = sqrt(2 n) H_{n - 1} and the weight
+	// for the standard weight exp(-x^2) is 2 / H_n'(x)^2. the initial guesses are from
+	// numerical recipes (gauher). the roots are symmetric, so only the positive ones are found
+	if (mDensity.Type() == NO_DENSITY_TYPE)
+		ThrowException("HermitePolynomial::GaussQuadrature : not initialized");
+	
+	if (numPoints <= 0)
+		ThrowException("HermitePolynomial::GaussQuadrature : non-positive number of points");
+	
+	const double piToMinusQuarter = 1.0 / sqrt(sqrt(PI));
+	
+	long n = numPoints;
+	Array<double> root(n);
+	Array<double> rootWeight(n);
+	
+	double x = 0.0;
+	for (long i = 0; i < (n + 1) / 2; ++i) {
+		if (i == 0)
+			x = sqrt(2.0 * n + 1.0) - 1.85575 * pow(2.0 * n + 1.0, -1.0 / 6.0);
+		else if (i == 1)
+			x -= 1.14 * pow((double) n, 0.426) / x;
+		else if (i == 2)
+			x = 1.86 * x - 0.86 * root[0];
+		else if (i == 3)
+			x = 1.91 * x - 0.91 * root[1];
+		else
+			x = 2.0 * x - root[i - 2];
+		
+		double derivative = 0.0;
+		for (short iteration = 0; iteration <= GAUSS_HERMITE_MAX_ITERATIONS; ++iteration) {
+			if (iteration == GAUSS_HERMITE_MAX_ITERATIONS)
+				ThrowException("HermitePolynomial::GaussQuadrature : newton iteration did not converge");
+			
+			double him1 = piToMinusQuarter;
+			double him2 = 0.0;
+			for (long k = 1; k <= n; ++k) {
+				double hi = x * sqrt(2.0 / k) * him1 - sqrt((k - 1.0) / k) * him2;
+				him2 = him1;
+				him1 = hi;
+			}
+			
+			derivative = sqrt(2.0 * n) * him2;
+			
+			double dx = him1 / derivative;
+			x -= dx;
+			
+			if (fabs(dx) <= GAUSS_HERMITE_TOLERANCE * max(1.0, fabs(x)))
+				break;
+		}
+		
+		root[i] = x;
+		rootWeight[i] = 2.0 / (derivative * derivative);
+		
+		root[n - 1 - i] = -x;
+		rootWeight[n - 1 - i] = rootWeight[i];
+	}
+	
+	// odd n has a root at zero
+	if (n % 2 == 1)
+		root[n / 2] = 0.0;
+	
+	// x = (X - mean) / (sqrt(2) sigma) takes the density to exp(-x^2) / sqrt(pi), so the
+	// weights for the density sum to one
+	node.SetSize(n);
+	weight.SetSize(n);
+	for (long i = 0; i < n; ++i) {
+		node[i] = mMean + SQRT_TWO * mSigma * root[n - 1 - i];
+		weight[i] = rootWeight[n - 1 - i] / sqrt(PI);
+	}
+	
+	return;
+}
+
+
+
 void HermitePolynomial::ComputeNormalizationFactors(short numFactors)
 {	
 	if (mNormalizationFactorsReady)
@@ -0,0 +1,536 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "integrator.h"
+#include "opbeconst.h"
+
+#include <gsl/gsl_errno.h>
+
+using namespace NAMESPACE;
+using namespace std;
+
+Integrator::Integrator(const Integrator &integrator)
+{
+	ThrowException("Integrator : copy constructor not implemented");
+	return;
+}
+
+
+
+void Integrator::Initialize(const RunControl &runControl, const OPBEParameter &parameter, 
+							const ModeIndex &modeIndex, long numModes)
+{
+	CleanUp();
+	
+	// right hand side
+	mParameters.mEpsilon = parameter.ViscosityCoefficient();
+	mParameters.mTModelOn = runControl.TModelOn();
+	mParameters.mNumModes = numModes;
+	mParameters.mSystemType = runControl.GetSystemType();
+	mParameters.mRHSMethod = runControl.GetRHSMethod();
+	mParameters.mModeIndex = modeIndex;
+	InitializeRHSWorkspace(mParameters);
+	
+	mLinear.Erase();
+	mTimeStep = runControl.TimeStep();
+	
+	// solver
+	if (runControl.SolverName() == "dopri5")
+		InitializeDormandPrince(runControl, numModes);
+	else if (runControl.SolverName() == "etdrk4")
+		InitializeETDRK4(runControl, numModes);
+	else if (runControl.SolverName() == "sdirk2")
+		InitializeSDIRK2(runControl, numModes);
+	else if (runControl.SolverName() == "ark43")
+		InitializeARK43(runControl, numModes);
+	else
+		InitializeGSL(runControl, numModes);
+	
+	mStepSize = DEFAULT_TIME_STEP;
+	
+	// dense output
+	mDenseOutput = runControl.DenseOutputOn();
+	mDenseValid = false;
+	mEndTime = runControl.EndTime();
+	
+	if (mDenseOutput) {
+		mLeftY.SetSize(numModes);
+		mLeftF.SetSize(numModes);
+		mRightY.SetSize(numModes);
+		mRightF.SetSize(numModes);
+		mDenseCorrection.SetSize(numModes);
+		mOutputY.SetSize(numModes);
+		
+		mDormandPrince.SetDenseOutput(mType == DOPRI5_INTEGRATOR);
+	}
+	
+	return;
+}
+
+
+
+void Integrator::InitializeGSL(const RunControl &runControl, long numModes)
+{
+	SetGSLStepType(runControl.SolverName());
+	mpStep = gsl_odeiv_step_alloc(mpStepType, numModes);
+	
+	// step control
+	double localAbsoluteError = runControl.GetLocalAbsoluteError();
+	double localRelativeError = runControl.GetLocalRelativeError();
+	mpControl = gsl_odeiv_control_y_new(localAbsoluteError, localRelativeError);
+	
+	// evolver
+	mpEvolve = gsl_odeiv_evolve_alloc(numModes);
+	
+	mType = GSL_INTEGRATOR;
+	
+	return;
+}
+
+
+
+void Integrator::InitializeDormandPrince(const RunControl &runControl, long numModes)
+{
+	if (mParameters.mSystemType != BURGERS_EQUATION)
+		ThrowException("Integrator::InitializeDormandPrince : dopri5 is only implemented for Burgers equation");
+	
+	double localAbsoluteError = runControl.GetLocalAbsoluteError();
+	double localRelativeError = runControl.GetLocalRelativeError();
+	mDormandPrince.Initialize(BurgersFunction(&mParameters), numModes, localAbsoluteError, localRelativeError);
+	
+	mType = DOPRI5_INTEGRATOR;
+	
+	return;
+}
+
+
+
+void Integrator::InitializeETDRK4(const RunControl &runControl, long numModes)
+{
+	if (mParameters.mSystemType != BURGERS_EQUATION)
+		ThrowException("Integrator::InitializeETDRK4 : etdrk4 is only implemented for Burgers equation");
+	
+	// the viscous term -epsilon k^2 u_k is the linear part, the right hand side is
+	// evaluated with zero viscosity for the nonlinear part
+	Array<double> linear(numModes);
+	for (long k = 1; k <= numModes; ++k)
+		linear[mParameters.mModeIndex(k)] = -mParameters.mEpsilon * k * k;
+	
+	mParameters.mEpsilon = 0.0;
+	mLinear = linear;
+	
+	mETDRK4.Initialize(BurgersFunction(&mParameters), linear, runControl.TimeStep());
+	
+	mType = ETDRK4_INTEGRATOR;
+	
+	return;
+}
+
+
+
+void Integrator::InitializeSDIRK2(const RunControl &runControl, long numModes)
+{
+	if (mParameters.mSystemType != BURGERS_EQUATION)
+		ThrowException("Integrator::InitializeSDIRK2 : sdirk2 is only implemented for Burgers equation");
+	
+	// the viscous term is the preconditioner, the right hand side is quadratic in u,
+	// cubic with the t-model
+	Array<double> linear(numModes);
+	for (long k = 1; k <= numModes; ++k)
+		linear[mParameters.mModeIndex(k)] = -mParameters.mEpsilon * k * k;
+	
+	short degree = mParameters.mTModelOn ? 3 : 2;
+	
+	double localAbsoluteError = runControl.GetLocalAbsoluteError();
+	double localRelativeError = runControl.GetLocalRelativeError();
+	mSDIRK2.Initialize(BurgersFunction(&mParameters), linear, degree, localAbsoluteError, localRelativeError);
+	
+	mType = SDIRK2_INTEGRATOR;
+	
+	return;
+}
+
+
+
+void Integrator::InitializeARK43(const RunControl &runControl, long numModes)
+{
+	if (mParameters.mSystemType != BURGERS_EQUATION)
+		ThrowException("Integrator::InitializeARK43 : ark43 is only implemented for Burgers equation");
+	
+	// the viscous term is the implicit part, the right hand side is evaluated 
+	// with zero viscosity for the explicit part
+	Array<double> linear(numModes);
+	for (long k = 1; k <= numModes; ++k)
+		linear[mParameters.mModeIndex(k)] = -mParameters.mEpsilon * k * k;
+	
+	mParameters.mEpsilon = 0.0;
+	mLinear = linear;
+	
+	double localAbsoluteError = runControl.GetLocalAbsoluteError();
+	double localRelativeError = runControl.GetLocalRelativeError();
+	mARK43.Initialize(BurgersFunction(&mParameters), linear, localAbsoluteError, localRelativeError);
+	
+	mType = ARK43_INTEGRATOR;
+	
+	return;
+}
+
+
+
+void Integrator::SetGSLStepType(const string &solverName)
+{
+	mpStepType = NULL;
+	
+	if (solverName == "rk2")
+		mpStepType = gsl_odeiv_step_rk2;
+		
+	if (solverName == "rk4")
+		mpStepType = gsl_odeiv_step_rk4;
+	
+	if (solverName == "rkf45")
+		mpStepType = gsl_odeiv_step_rkf45;
+	
+	if (solverName == "rkck")
+		mpStepType = gsl_odeiv_step_rkck;
+	
+	if (solverName == "rk8pd")
+		mpStepType = gsl_odeiv_step_rk8pd;
+	
+	if (solverName == "rk2imp")
+		mpStepType = gsl_odeiv_step_rk2imp;
+	
+	if (solverName == "rk4imp")
+		mpStepType = gsl_odeiv_step_rk4imp;
+	
+	if (solverName == "bsimp")
+		mpStepType = gsl_odeiv_step_bsimp;
+	
+	if (solverName == "gear1")
+		mpStepType = gsl_odeiv_step_gear1;
+		
+	if (solverName == "gear2")
+		mpStepType = gsl_odeiv_step_gear2;
+		
+	if (mpStepType == NULL)
+		ThrowException("Integrator::SetGSLStepType : invalid gsl solver name: " + solverName);
+	
+	return;
+}
+
+
+
+void Integrator::CleanUp()
+{
+	mType = NO_INTEGRATOR_TYPE;
+	mpStepType = NULL;
+	
+	if (mpEvolve != NULL)
+		gsl_odeiv_evolve_free(mpEvolve);
+	mpEvolve = NULL;
+	
+	if (mpControl != NULL)
+		gsl_odeiv_control_free(mpControl);
+	mpControl = NULL;
+	
+	if (mpStep != NULL)
+		gsl_odeiv_step_free(mpStep);
+	mpStep = NULL;
+	
+	mParameters.mFFT.CleanUp();
+	mParameters.mpFixedSize = NULL;
+	
+	mDenseValid = false;
+	
+	return;
+}
+
+
+
+void Integrator::Reset()
+{
+	mStepSize = DEFAULT_TIME_STEP;
+	
+	if (mpStep != NULL)
+		gsl_odeiv_step_reset(mpStep);
+	
+	if (mpEvolve != NULL)
+		gsl_odeiv_evolve_reset(mpEvolve);
+	
+	mDormandPrince.Reset();
+	mDenseValid = false;
+	
+	return;
+}
+
+
+
+void Integrator::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	// the first stage of dopri5 is recomputed from (t, y) after a restart, which gives
+	// the same value as the one that was carried, so it isn't saved
+	checkpoint.WriteDouble(mStepSize);
+	checkpoint.WriteInteger(mDenseValid);
+	
+	if (mDenseValid == false)
+		return;
+	
+	checkpoint.WriteDouble(mLeftTime);
+	checkpoint.WriteDouble(mRightTime);
+	checkpoint.WriteDouble(mOutputTime);
+	checkpoint.WriteArray(mLeftY);
+	checkpoint.WriteArray(mLeftF);
+	checkpoint.WriteArray(mRightY);
+	checkpoint.WriteArray(mRightF);
+	checkpoint.WriteArray(mDenseCorrection);
+	checkpoint.WriteArray(mOutputY);
+	
+	return;
+}
+
+
+
+void Integrator::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	Reset();
+	
+	mStepSize = checkpoint.ReadDouble();
+	mDenseValid = (checkpoint.ReadInteger() != 0);
+	
+	if (mDenseValid == false)
+		return;
+	
+	if (mDenseOutput == false)
+		ThrowException("Integrator::ReadCheckpoint : checkpoint has dense output, but dense output is off");
+	
+	mLeftTime = checkpoint.ReadDouble();
+	mRightTime = checkpoint.ReadDouble();
+	mOutputTime = checkpoint.ReadDouble();
+	checkpoint.ReadArray(mLeftY);
+	checkpoint.ReadArray(mLeftF);
+	checkpoint.ReadArray(mRightY);
+	checkpoint.ReadArray(mRightF);
+	checkpoint.ReadArray(mDenseCorrection);
+	checkpoint.ReadArray(mOutputY);
+	
+	if (mRightY.Size() != mParameters.mNumModes)
+		ThrowException("Integrator::ReadCheckpoint : checkpoint has the wrong number of modes");
+	
+	return;
+}
+
+
+
+void Integrator::Evolve(double &t, double t1, double y[])
+{
+	if (Initialized() == false)
+		ThrowException("Integrator::Evolve : not initialized");
+	
+	if (mDenseOutput) {
+		DenseEvolve(t, t1, y);
+		return;
+	}
+	
+	if (mType == DOPRI5_INTEGRATOR) {
+		mDormandPrince.Evolve(t, t1, mStepSize, y);
+		return;
+	}
+	
+	if (mType == ETDRK4_INTEGRATOR) {
+		mETDRK4.Evolve(t, t1, y);
+		return;
+	}
+	
+	if (mType == SDIRK2_INTEGRATOR) {
+		mSDIRK2.Evolve(t, t1, mStepSize, y);
+		return;
+	}
+	
+	if (mType == ARK43_INTEGRATOR) {
+		mARK43.Evolve(t, t1, mStepSize, y);
+		return;
+	}
+	
+	// call ode solver
+	while (t < t1) 
+		GSLStep(t, t1, y);
+	
+	return;
+}
+
+
+
+void Integrator::GSLStep(double &t, double t1, double y[])
+{
+	// the analytic jacobian is only there for Burgers equation
+	gsl_odeiv_system system = {TimeDerivative, NULL, (size_t) mParameters.mNumModes, &mParameters};
+	if (mParameters.mSystemType == BURGERS_EQUATION)
+		system.jacobian = Jacobian;
+	
+	// one step, not past t1
+	int status = gsl_odeiv_evolve_apply(mpEvolve, mpControl, mpStep, &system, &t, t1, &mStepSize, y);
+	
+	if (status != GSL_SUCCESS) 
+		ThrowException("Integrator::Evolve : gsl step unsuccessful, gsl_status = " + ConvertIntegerToString(status));
+	
+	return;
+}
+
+
+
+void Integrator::DenseEvolve(double &t, double t1, double y[])
+{
+	// the solver steps freely up to the end time, and y(t1) is interpolated in the step
+	// [mLeftTime, mRightTime] that contains t1. a (t, y) that isn't the last value handed
+	// back means someone reset the system, so the interpolation starts over from there
+	if (mDenseValid && t == mOutputTime) {
+		for (long i = 0; i < mParameters.mNumModes && mDenseValid; ++i) {
+			if (y[i] != mOutputY[i])
+				mDenseValid = false;
+		}
+	}
+	else {
+		mDenseValid = false;
+	}
+	
+	if (mDenseValid == false)
+		StartDenseOutput(t, y);
+	
+	if (t1 <= t)
+		return;
+	
+	double tBound = (t1 > mEndTime) ? t1 : mEndTime;
+	long numModes = mParameters.mNumModes;
+	
+	while (mRightTime < t1) {
+		mLeftTime = mRightTime;
+		mLeftY = mRightY;
+		mLeftF = mRightF;
+		
+		TakeStep(mRightTime, tBound, mRightY.Begin());
+		
+		if (mType == DOPRI5_INTEGRATOR) {
+			mRightF = mDormandPrince.Derivative();
+			mDenseCorrection = mDormandPrince.DenseCorrection();
+		}
+		else {
+			Derivative(mRightTime, mRightY.Begin(), mRightF.Begin());
+		}
+	}
+	
+	// cubic Hermite interpolation, plus the fourth order term for dopri5. with
+	// theta = (t1 - t_left) / h, in the form used by Hairer and Wanner
+	//
+	// y = y_left + theta (r2 + (1 - theta) (r3 + theta (r4 + (1 - theta) r5)))
+	//
+	// r2 = y_right - y_left, r3 = h f_left - r2, r4 = r2 - h f_right - r3
+	double h = mRightTime - mLeftTime;
+	double theta = (h > 0.0) ? (t1 - mLeftTime) / h : 1.0;
+	bool correction = (mType == DOPRI5_INTEGRATOR);
+	
+	for (long i = 0; i < numModes; ++i) {
+		double r2 = mRightY[i] - mLeftY[i];
+		double r3 = h * mLeftF[i] - r2;
+		double r4 = r2 - h * mRightF[i] - r3;
+		double r5 = correction ? mDenseCorrection[i] : 0.0;
+		
+		y[i] = mLeftY[i] + theta * (r2 + (1.0 - theta) * (r3 + theta * (r4 + (1.0 - theta) * r5)));
+	}
+	
+	if (t1 == mRightTime) {
+		for (long i = 0; i < numModes; ++i)
+			y[i] = mRightY[i];
+	}
+	
+	t = t1;
+	
+	mOutputTime = t;
+	for (long i = 0; i < numModes; ++i)
+		mOutputY[i] = y[i];
+	
+	return;
+}
+
+
+
+void Integrator::StartDenseOutput(double t, const double y[])
+{
+	long numModes = mParameters.mNumModes;
+	
+	mRightTime = t;
+	for (long i = 0; i < numModes; ++i)
+		mRightY[i] = y[i];
+	
+	Derivative(t, y, mRightF.Begin());
+	
+	mLeftTime = mRightTime;
+	mLeftY = mRightY;
+	mLeftF = mRightF;
+	
+	mOutputTime = t;
+	for (long i = 0; i < numModes; ++i)
+		mOutputY[i] = y[i];
+	
+	mDenseValid = true;
+	
+	return;
+}
+
+
+
+void Integrator::TakeStep(double &t, double t1, double y[])
+{
+	switch (mType) {
+	case DOPRI5_INTEGRATOR:
+		mDormandPrince.TakeStep(t, t1, mStepSize, y);
+		break;
+	
+	case ETDRK4_INTEGRATOR:
+		mETDRK4.Evolve(t, (t + mTimeStep < t1) ? t + mTimeStep : t1, y);
+		break;
+	
+	case SDIRK2_INTEGRATOR:
+		mSDIRK2.TakeStep(t, t1, mStepSize, y);
+		break;
+	
+	case ARK43_INTEGRATOR:
+		mARK43.TakeStep(t, t1, mStepSize, y);
+		break;
+	
+	default:
+		GSLStep(t, t1, y);
+		break;
+	}
+	
+	return;
+}
+
+
+
+void Integrator::Derivative(double t, const double y[], double f[])
+{
+	// the full right hand side, including a linear part that the solver handles itself
+	TimeDerivative(t, y, f, &mParameters);
+	
+	if (mLinear.Empty() == false) {
+		for (long i = 0; i < mParameters.mNumModes; ++i)
+			f[i] += mLinear[i] * y[i];
+	}
+	
+	return;
+}
@@ -27,6 +27,8 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <math.h>
+#include <time.h>
 
 #include <gsl/gsl_randist.h>
 
@@ -41,6 +43,45 @@ MKProblem::MKProblem(const MKProblem &sol)
 
 
 
+namespace NAMESPACE {
+	// runs one block of monte carlo trajectories per task, on the worker's System
+	class MonteCarloTask : public ThreadPoolTask {
+	 public:
+		MonteCarloTask(MKProblem &problem, long firstBlock) : mProblem(problem), mFirstBlock(firstBlock) { };
+		void Execute(long taskIndex, long worker)
+		{
+			const double *point = NULL;
+			if (mProblem.mQuasiRandomPoint.Size() > 0)
+				point = mProblem.mQuasiRandomPoint.Begin() + taskIndex * mProblem.BlockSize() * mProblem.mNumModes;
+			
+			mProblem.RunBlock(mFirstBlock + taskIndex, worker, point, mProblem.mBlockStatistics[taskIndex]);
+		}
+		
+	 private:
+		MKProblem &mProblem;
+		long mFirstBlock;
+	};
+	
+	
+	
+	// runs one block of coupled trajectories of a level per task
+	class MultilevelTask : public ThreadPoolTask {
+	 public:
+		MultilevelTask(MKProblem &problem, long level, long firstBlock) : mProblem(problem), mLevel(level), mFirstBlock(firstBlock) { };
+		void Execute(long taskIndex, long worker)
+		{
+			mProblem.RunLevelBlock(mLevel, mFirstBlock + taskIndex, worker, mProblem.mBlockStatistics[taskIndex]);
+		}
+		
+	 private:
+		MKProblem &mProblem;
+		long mLevel;
+		long mFirstBlock;
+	};
+}
+
+
+
 void MKProblem::Run(const string &fileName)
 {
 	// read input file
@@ -53,14 +94,15 @@ void MKProblem::Run(const string &fileName)
 	if (mRunControl.RunClockOn())
 		clock.Start();
 
-	for (mRunCount = 1; mRunCount <= mNumMonteCarloRuns; ++mRunCount) {
-		Run();
-		mRunControl.PrintRunCount(mRunCount);
-	}
+	Run();
 	
 	clock.StopAndPrintTime();
 	
-	mSystem[0].CleanUpSolver();
+	for (long i = 0; i < mSystem.Size(); ++i)
+		mSystem[i].CleanUpSolver();
+	
+	for (long i = 0; i < mLevelSystem.Size(); ++i)
+		mLevelSystem[i].CleanUpSolver();
 
 	WriteVolterraFFile();
 	
@@ -72,101 +114,734 @@ void MKProblem::Run(const string &fileName)
 
 void MKProblem::Run()
 {
-	ComputeInitialData();
-	Reset();
+	if (mNumLevels > 1) {
+		RunMultilevel();
+		return;
+	}
+	
+	// the runs are split into blocks, each with its own random number stream and
+	// accumulator. the block accumulators are merged in block order, so the result
+	// doesn't depend on the number of threads.
+	long numBlocks = (mNumMonteCarloRuns + BlockSize() - 1) / BlockSize();
+	long numBlocksPerBatch = MONTE_CARLO_BLOCKS_PER_THREAD * mThreadPool.NumThreads();
+	
+	long sampleSize = mRunControl.NumOutputTimes() * mNumResolvedModes;
+	mStatistics.Initialize(sampleSize, mNumControls);
 	
-	SetBigS();
+	mBlockStatistics.SetSize(numBlocksPerBatch);
+	for (long i = 0; i < numBlocksPerBatch; ++i)
+		mBlockStatistics[i].Initialize(sampleSize, mNumControls);
+	
+	if (mSamplingType == QUASI_RANDOM_SAMPLING) {
+		mQuasiRandomPoint.SetSize(numBlocksPerBatch * BlockSize() * mNumModes);
+		
+		mReplicateStatistics.SetSize(mNumReplicates);
+		for (long r = 0; r < mNumReplicates; ++r)
+			mReplicateStatistics[r].Initialize(sampleSize);
+	}
 	
 	mRunControl.SetState(SYSTEM_RUN);
 	
-	for (long i = 0; i < mRunControl.NumOutputTimes(); ++i) {
-		Evolve(mRunControl.OutputTime(i));
-		UpdateVolterraCoefficients(i);
-	}		
+	// a checkpoint holds the blocks merged so far, and the block to continue from
+	long startBlock = RestoreCheckpoint();
+	bool converged = false;
 	
+	for (long firstBlock = startBlock; firstBlock < numBlocks && converged == false; firstBlock += numBlocksPerBatch) {
+		long numBatchBlocks = min(numBlocksPerBatch, numBlocks - firstBlock);
+		
+		if (mSamplingType == QUASI_RANDOM_SAMPLING)
+			ComputeQuasiRandomPoints(firstBlock, numBatchBlocks);
+		
+		MonteCarloTask task(*this, firstBlock);
+		mThreadPool.Run(task, numBatchBlocks);
 		
+		for (long i = 0; i < numBatchBlocks; ++i) {
+			long runCount = mStatistics.Count() * RunsPerSample();
+			mStatistics.Merge(mBlockStatistics[i]);
+			
+			if (mSamplingType == QUASI_RANDOM_SAMPLING) {
+				Array<double> mean;
+				mBlockStatistics[i].Means(mean);
+				mReplicateStatistics[(firstBlock + i) * BlockSize() / mRunsPerReplicate].Merge(mBlockStatistics[i].Count(), mean);
+			}
+			
+			for (long n = runCount + 1; n <= mStatistics.Count() * RunsPerSample(); ++n)
+				mRunControl.PrintRunCount(n);
+			
+			// stop once every entry is within the target, tested after every block in block
+			// order so the stopping point doesn't depend on the number of threads
+			if (mTargetStandardError > 0.0 && mStatistics.Count() * RunsPerSample() >= MIN_SEQUENTIAL_RUNS &&
+				ComputeStandardError() <= mTargetStandardError) {
+				converged = true;
+				break;
+			}
+		}
+		
+		if (converged == false && CheckpointDue())
+			SaveCheckpoint(firstBlock + numBatchBlocks);
+	}
+	
 	mRunControl.SetState(SYSTEM_STOP);
 	
+	double maxError = ComputeStandardError();
+	if (mTargetStandardError > 0.0)
+		cout << mStatistics.Count() * RunsPerSample() << " runs, largest standard error " << maxError 
+			 << " (target " << mTargetStandardError << ")" << endl;
+	
+	if (mSamplingType == QUASI_RANDOM_SAMPLING)
+		PrintReplicateError(mReplicateStatistics);
+	
+	if (mNumControls > 0)
+		PrintVarianceReduction();
+	
+	// Volterra coefficients, the mean corrected by the controls
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		for (short i = 0; i < mNumResolvedModes; ++i) {
+			long entry = n * mNumResolvedModes + i;
+			mVolterraF0(n, i) = mStatistics.Estimate(entry, mControlMean.Begin() + entry * mNumControls);
+		}
+	}
+	
     return;
 }
 
 
 
-void MKProblem::UpdateVolterraCoefficients(long timeStep)
+void MKProblem::RunMultilevel()
 {
-	UpdateVolterraFAverage(timeStep);
+	// pilot runs on every level, then runs are added until each level has the number the
+	// current variance and cost estimates call for. the level means are summed
+	long sampleSize = mRunControl.NumOutputTimes() * mNumResolvedModes;
+	long numBlocksPerBatch = MONTE_CARLO_BLOCKS_PER_THREAD * mThreadPool.NumThreads();
+	
+	mLevelStatistics.SetSize(mNumLevels);
+	mLevelTime.SetSize(mNumLevels);
+	for (long l = 0; l < mNumLevels; ++l) {
+		mLevelStatistics[l].Initialize(sampleSize, 0);
+		mLevelTime[l] = 0.0;
+	}
+	
+	mBlockStatistics.SetSize(numBlocksPerBatch);
+	for (long i = 0; i < numBlocksPerBatch; ++i)
+		mBlockStatistics[i].Initialize(sampleSize, 0);
+	
+	mRunControl.SetState(SYSTEM_RUN);
+	
+	for (long l = 0; l < mNumLevels; ++l)
+		RunLevel(l, mNumPilotRuns);
+	
+	// the allocation is for the variance summed over the entries. with a target standard
+	// error that is target^2 per entry, and it is tightened until the largest entry meets
+	// the target, or the runs stop growing at the cap
+	double scale = 1.0;
+	for (long pass = 0; ; ++pass) {
+		long numAdded = 0;
+		
+		Array<long> numRuns;
+		bool done = false;
+		while (done == false) {
+			double targetVariance = (mTargetStandardError > 0.0) ? 
+				mTargetStandardError * mTargetStandardError * sampleSize : LevelVariance(0) / mNumMonteCarloRuns;
+			
+			AllocateLevelRuns(scale * targetVariance, numRuns);
+			
+			done = true;
+			for (long l = 0; l < mNumLevels; ++l) {
+				long count = mLevelStatistics[l].Count();
+				if (numRuns[l] > count) {
+					RunLevel(l, numRuns[l]);
+					numAdded += mLevelStatistics[l].Count() - count;
+					done = false;
+				}
+			}
+		}
+		
+		if (mTargetStandardError <= 0.0)
+			break;
+		
+		double maxError = ComputeStandardError();
+		if (maxError <= mTargetStandardError || (pass > 0 && numAdded == 0))
+			break;
+		
+		scale *= (mTargetStandardError / maxError) * (mTargetStandardError / maxError);
+	}
+	
+	mRunControl.SetState(SYSTEM_STOP);
+	
+	PrintLevels();
+	
+	double maxError = ComputeStandardError();
+	if (mTargetStandardError > 0.0)
+		cout << "largest standard error " << maxError << " (target " << mTargetStandardError << ")" << endl;
+	
+	// Volterra coefficients
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		for (short i = 0; i < mNumResolvedModes; ++i) {
+			double sum = 0.0;
+			for (long l = 0; l < mNumLevels; ++l)
+				sum += mLevelStatistics[l].Mean(n * mNumResolvedModes + i);
+			
+			mVolterraF0(n, i) = sum;
+		}
+	}
+	
+	return;
+}
+
+
 
+void MKProblem::RunLevel(long level, long numRuns)
+{
+	// a level always runs whole blocks, continuing from the blocks it has, and block b of
+	// level l has random number stream b L + l
+	ControlVariateStatistics &statistics = mLevelStatistics[level];
+	
+	long numBlocks = (numRuns + BlockSize() - 1) / BlockSize();
+	long numBlocksPerBatch = mBlockStatistics.Size();
+	
+	// the cost is processor time, summed over the threads
+	clock_t start = clock();
+	
+	for (long firstBlock = statistics.Count() / BlockSize(); firstBlock < numBlocks; firstBlock += numBlocksPerBatch) {
+		long numBatchBlocks = min(numBlocksPerBatch, numBlocks - firstBlock);
+		
+		MultilevelTask task(*this, level, firstBlock);
+		mThreadPool.Run(task, numBatchBlocks);
+		
+		for (long i = 0; i < numBatchBlocks; ++i)
+			statistics.Merge(mBlockStatistics[i]);
+	}
+	
+	mLevelTime[level] += (double) (clock() - start) / CLOCKS_PER_SEC;
+	
 	return;
 }
 
 
 
-void MKProblem::UpdateVolterraFAverage(long timeStep)
+void MKProblem::RunLevelBlock(long level, long block, long worker, ControlVariateStatistics &statistics)
 {
-	static double fa, fb;
+	gsl_rng *pRNG = AllocateRandomNumberGenerator();
+	gsl_rng_set(pRNG, StreamSeed(block * mNumLevels + level));
+	
+	statistics.Reset();
+	
+	long numThreads = mThreadPool.NumThreads();
+	System &fine = mLevelSystem[level * numThreads + worker];
 	
-	if (mRunCount == 1) {
-		fa = 0.0;
-		fb = 1.0;
+	Array<double> sample(statistics.Size()), control;
+	
+	for (long run = 0; run < BlockSize(); ++run) {
+		for (long i = 0; i < sample.Size(); ++i)
+			sample[i] = 0.0;
+		
+		ComputeInitialData(fine, pRNG);
+		EvolveSample(fine, 1.0, sample.Begin());
+		
+		// the coarse run starts from the leading modes of the same draw
+		if (level > 0) {
+			System &coarse = mLevelSystem[(level - 1) * numThreads + worker];
+			for (long i = 0; i < mLevelModes[level - 1]; ++i)
+				coarse.SetInitialCondition(i, fine.InitialCondition(i));
+			
+			EvolveSample(coarse, -1.0, sample.Begin());
+		}
+		
+		statistics.Add(sample, control);
 	}
-	else {
-		fa = 1.0 / mRunCount;
-		fb = 1.0 - fa;
+	
+	gsl_rng_free(pRNG);
+	
+	return;
+}
+
+
+
+void MKProblem::AllocateLevelRuns(double targetVariance, Array<long> &numRuns) const
+{
+	// the runs that minimize the cost for a given variance V of the sum of the level means,
+	// N_l = sqrt(V_l / C_l) sum_k sqrt(V_k C_k) / V (Giles), with V_l the variance summed
+	// over the entries and C_l the cost per run (levelcost, else measured). with a target
+	// standard error no level goes past numberofruns
+	Array<double> variance(mNumLevels), cost(mNumLevels);
+	
+	double sum = 0.0;
+	for (long l = 0; l < mNumLevels; ++l) {
+		variance[l] = LevelVariance(l);
+		if (mLevelCost.Size() == mNumLevels)
+			cost[l] = mLevelCost[l];
+		else
+			cost[l] = max(mLevelTime[l], 1.0 / CLOCKS_PER_SEC) / mLevelStatistics[l].Count();
+		
+		sum += sqrt(variance[l] * cost[l]);
 	}
 	
-	for (short i = 0; i < mNumResolvedModes; ++i) {
-		double newValue = -mSystem[0].ResolvedNoise(i) * mBigS;
-		//double oldValue = mVolterraF0(timeStep, i);
-		mVolterraF0(timeStep, i) = fb * newValue + fa * mVolterraF0(timeStep, i);
+	numRuns.SetSize(mNumLevels);
+	for (long l = 0; l < mNumLevels; ++l) {
+		numRuns[l] = mLevelStatistics[l].Count();
+		
+		if (targetVariance > 0.0) {
+			double runs = sqrt(variance[l] / cost[l]) * sum / targetVariance;
+			if (mTargetStandardError > 0.0)
+				runs = min(runs, (double) mNumMonteCarloRuns);
+			
+			numRuns[l] = max(numRuns[l], (long) ceil(runs));
+		}
+	}
+	
+	return;
+}
+
+
+
+double MKProblem::LevelVariance(long level) const
+{
+	// summed over the entries
+	const ControlVariateStatistics &statistics = mLevelStatistics[level];
+	
+	double variance = 0.0;
+	for (long i = 0; i < statistics.Size(); ++i)
+		variance += statistics.Variance(i);
+	
+	return variance;
+}
+
+
+
+void MKProblem::PrintLevels() const
+{
+	cout << "Multilevel Monte Carlo" << endl;
+	
+	for (long l = 0; l < mNumLevels; ++l) {
+		const ControlVariateStatistics &statistics = mLevelStatistics[l];
+		
+		cout << "level " << l << ", " << mLevelModes[l] << " modes, absolute error " << mLevelAbsoluteError[l] 
+			 << ", " << statistics.Count() << " runs, variance " << LevelVariance(l) 
+			 << ", seconds per run " << mLevelTime[l] / statistics.Count() << endl;
+	}
+	
+	if (mLevelCost.Size() != mNumLevels)
+		cout << "runs allocated from the measured times, so they (and the estimate) change from run to run, "
+			 << "levelcost={...} fixes them" << endl;
+	
+	return;
+}
+
+
+
+long MKProblem::BlockSize() const
+{
+	// when batching, a block is one batch
+	if (mRunControl.BatchSize() > 0)
+		return mRunControl.BatchSize();
+	
+	return MONTE_CARLO_BLOCK_SIZE;
+}
+
+
+
+long MKProblem::RunsPerSample() const
+{
+	// an antithetic sample is a run and its mirror image
+	return mAntithetic ? 2 : 1;
+}
+
+
+
+void MKProblem::RunBlock(long block, long worker, const double point[], ControlVariateStatistics &statistics)
+{
+	gsl_rng *pRNG = AllocateRandomNumberGenerator();
+	gsl_rng_set(pRNG, StreamSeed(block));
+	
+	statistics.Reset();
+	
+	long firstRun = block * BlockSize();
+	long lastRun = min(firstRun + BlockSize(), mNumMonteCarloRuns);
+	
+	if (mRunControl.BatchSize() > 0)
+		RunBatch(lastRun - firstRun, pRNG, point, mSystem[worker], mBatchIntegrator[worker], statistics);
+	else 
+		RunSerial(lastRun - firstRun, pRNG, point, mSystem[worker], statistics);
+	
+	gsl_rng_free(pRNG);
+	
+	return;
+}
+
+
+
+void MKProblem::RunSerial(long numRuns, gsl_rng *pRNG, const double point[], System &system, 
+						  ControlVariateStatistics &statistics) const
+{
+	long runsPerSample = RunsPerSample();
+	double weight = 1.0 / runsPerSample;
+	
+	Array<double> sample(statistics.Size());
+	Array<double> control(statistics.Size() * mNumControls);
+	
+	for (long run = 0; run < numRuns; run += runsPerSample) {
+		for (long i = 0; i < sample.Size(); ++i)
+			sample[i] = 0.0;
+		
+		for (long i = 0; i < control.Size(); ++i)
+			control[i] = 0.0;
+		
+		for (long r = 0; r < runsPerSample; ++r) {
+			if (r == 0)
+				ComputeInitialData(system, pRNG, (point != NULL) ? point + run * mNumModes : NULL);
+			else
+				MirrorInitialData(system);
+			
+			double bigS = EvolveSample(system, weight, sample.Begin());
+			
+			if (mNumControls > 0)
+				AccumulateControls(system, bigS, weight, control.Begin());
+		}
+		
+		statistics.Add(sample, control);
+	}
+	
+	return;
+}
+
+
+
+void MKProblem::RunBatch(long numRuns, gsl_rng *pRNG, const double point[], System &system, 
+						 BatchIntegrator &integrator, ControlVariateStatistics &statistics) const
+{
+	// all runs of the block evolve together, system is only used for the initial data
+	// and to evaluate the resolved noise of each member. the runs of an antithetic
+	// sample are neighbouring members
+	long runsPerSample = RunsPerSample();
+	double weight = 1.0 / runsPerSample;
+	
+	long sampleSize = statistics.Size();
+	long controlSize = sampleSize * mNumControls;
+	Array<double> sample(numRuns * sampleSize);
+	Array<double> control(numRuns / runsPerSample * controlSize);
+	Array<double> bigS(numRuns);
+	
+	for (long i = 0; i < control.Size(); ++i)
+		control[i] = 0.0;
+	
+	Array<double> zero(mNumModes);
+	for (long i = 0; i < mNumModes; ++i)
+		zero[i] = 0.0;
+	
+	// unused lanes of a partial batch stay at zero
+	for (long b = 0; b < integrator.BatchSize(); ++b) {
+		if (b < numRuns) {
+			if (b % runsPerSample == 0)
+				ComputeInitialData(system, pRNG, (point != NULL) ? point + b * mNumModes : NULL);
+			else
+				MirrorInitialData(system);
+			
+			system.SetToInitialCondition();
+			bigS[b] = BigS(system);
+			integrator.SetMember(b, system.Modes().Begin());
+			
+			if (mNumControls > 0)
+				AccumulateControls(system, bigS[b], weight, control.Begin() + b / runsPerSample * controlSize);
+		}
+		else {
+			integrator.SetMember(b, zero.Begin());
+		}
+	}
+	
+	integrator.Reset();
+	double t = mRunControl.StartTime();
+	
+	Array<double> modes(mNumModes);
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		integrator.Evolve(t, mRunControl.OutputTime(n));
+		
+		for (long b = 0; b < numRuns; ++b) {
+			integrator.GetMember(b, modes.Begin());
+			system.SetModes(modes);
+			
+			for (short i = 0; i < mNumResolvedModes; ++i)
+				sample[b * sampleSize + n * mNumResolvedModes + i] = -system.ResolvedNoise(i) * bigS[b];
+		}
 	}
 	
+	// accumulate in run order
+	Array<double> runSample(sampleSize), runControl(controlSize);
+	for (long b = 0; b < numRuns; b += runsPerSample) {
+		for (long i = 0; i < sampleSize; ++i) {
+			runSample[i] = 0.0;
+			for (long r = 0; r < runsPerSample; ++r)
+				runSample[i] += weight * sample[(b + r) * sampleSize + i];
+		}
+		
+		for (long i = 0; i < controlSize; ++i)
+			runControl[i] = control[b / runsPerSample * controlSize + i];
+		
+		statistics.Add(runSample, runControl);
+	}
 	
 	return;
 }
 
 
 
-void MKProblem::SetBigS() 
+double MKProblem::EvolveSample(System &system, double weight, double sample[]) const
+{
+	// evolve system from its initial data and add weight times the sample -R_i S at each
+	// output time, returns S
+	system.SetCurrentTime(mRunControl.StartTime());
+	system.SetToInitialCondition();
+	
+	double bigS = BigS(system);
+	
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		system.Evolve(mRunControl.OutputTime(n));
+		
+		for (short i = 0; i < mNumResolvedModes; ++i)
+			sample[n * mNumResolvedModes + i] -= weight * system.ResolvedNoise(i) * bigS;
+	}
+	
+	return bigS;
+}
+
+
+
+double MKProblem::BigS(const System &system) const
 {
 	Array<double> rhs;
 	
-	double sumKSquared = mNumModes * (2.0 * mNumModes * mNumModes + 3.0 * mNumModes + 1) / 6.0;
+	// the system may be a truncation with fewer modes (multilevel)
+	long numModes = system.Modes().Size();
+	double sumKSquared = numModes * (2.0 * numModes * numModes + 3.0 * numModes + 1) / 6.0;
 	
 	double divR = -sumKSquared * mOPBEParameter.ViscosityCoefficient();
-	for (long k = 2; k <= mNumModes; k = k + 2) 
-		divR += 0.5 * k * mSystem[0].U(k);
+	for (long k = 2; k <= numModes; k = k + 2) 
+		divR += 0.5 * k * system.U(k);
 	
-	mSystem[0].RHS(rhs);
+	system.RHS(rhs);
 	double sum = 0.0;
-	for (long i = 0; i < mNumModes; ++i) {
+	for (long i = 0; i < numModes; ++i) {
 		double mean = mInitialDensity[i].GetParameter(0);
 		double sigma = mInitialDensity[i].GetParameter(1);
 		
-		double densityTerm = -(mSystem[0].InitialCondition(i) - mean) / (sigma * sigma);
+		double densityTerm = -(system.InitialCondition(i) - mean) / (sigma * sigma);
 		sum += rhs[i] * densityTerm;
 	}
 	
-	mBigS = divR + sum;
-	
-	return;
+	return divR + sum;
 }
 	
 
 
-void MKProblem::ComputeInitialData()
+void MKProblem::ComputeInitialData(System &system, gsl_rng *pRNG, const double u[]) const
 {
-	for (long i = 0; i < mNumModes; ++i) {
+	for (long i = 0; i < system.Modes().Size(); ++i) {
 		if (mInitialDensity[i].GetModeIndex() != i)
 			ThrowException("MKProblem::ComputeInitialData : bad initial density array");
 		
+		double x;
+		if (u != NULL) {
+			x = mInitialDensity[i].InverseCDF(u[i]);
+		}
+		else {
+			double mean = mInitialDensity[i].GetParameter(0);
+			double sigma = mInitialDensity[i].GetParameter(1);
+			
+			x = GaussianRandomVariable(pRNG, mean, sigma);
+		}
+		
+		system.SetInitialCondition(i, x);
+	}
+	
+	
+	return;
+}
+
+
+
+void MKProblem::MirrorInitialData(System &system) const
+{
+	// reflect the initial data of the previous run about the density mean
+	for (long i = 0; i < mNumModes; ++i) {
 		double mean = mInitialDensity[i].GetParameter(0);
-		double sigma = mInitialDensity[i].GetParameter(1);
+		system.SetInitialCondition(i, 2.0 * mean - system.InitialCondition(i));
+	}
+	
+	return;
+}
+
+
+
+void MKProblem::AccumulateControls(const System &system, double bigS, double weight, double control[]) const
+{
+	// control 0 is the sample at t = 0, -R_i(u(0)) S, and control 1 is the sample along the
+	// linearised (viscous) flow u_k(t) = exp(-epsilon k^2 (t - t0)) u_k(0). both only need
+	// the initial data. control[entry * mNumControls + c] += weight * control c
+	for (short i = 0; i < mNumResolvedModes; ++i) {
+		long m = i + 1;
 		
-		double x = GaussianRandomVariable(mean, sigma);
+		double noise = 0.0;
+		for (long kp = mNumResolvedModes - m + 1; kp <= mNumModes - m; ++kp)
+			noise += system.InitialCondition(mModeIndex(kp)) * system.InitialCondition(mModeIndex(m + kp));
 		
-		mSystem[0].SetInitialCondition(i, x);
+		for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+			double linearNoise = 0.0;
+			for (long kp = mNumResolvedModes - m + 1; kp <= mNumModes - m; ++kp) {
+				long a = mModeIndex(kp);
+				long b = mModeIndex(m + kp);
+				linearNoise += mDecay(n, a) * mDecay(n, b) * system.InitialCondition(a) * system.InitialCondition(b);
+			}
+			
+			double *entryControl = control + (n * mNumResolvedModes + i) * mNumControls;
+			entryControl[0] -= weight * 0.5 * m * noise * bigS;
+			entryControl[1] -= weight * 0.5 * m * linearNoise * bigS;
+		}
 	}
 	
+	return;
+}
+
+
+
+void MKProblem::ComputeControlMeans()
+{
+	// S is div(rho R) / rho for the gaussian initial density rho and the right hand side R,
+	// so integrating by parts, E[-g S] = E[R . grad g] for the controls -g S. R is quadratic
+	// and grad g is linear, so the degree 3 rule with the 2 N points mean +- sqrt(N) sigma_j e_j
+	// and equal weights gives the means exactly
+	long numOutputTimes = mRunControl.NumOutputTimes();
+	
+	mDecay.SetSize(numOutputTimes, mNumModes);
+	for (long n = 0; n < numOutputTimes; ++n) {
+		double t = mRunControl.OutputTime(n) - mRunControl.StartTime();
+		
+		for (long k = 1; k <= mNumModes; ++k)
+			mDecay(n, mModeIndex(k)) = exp(-mOPBEParameter.ViscosityCoefficient() * k * k * t);
+	}
+	
+	mControlMean.SetSize(numOutputTimes * mNumResolvedModes * mNumControls);
+	for (long i = 0; i < mControlMean.Size(); ++i)
+		mControlMean[i] = 0.0;
+	
+	System &system = mSystem[0];
+	Array<double> point(mNumModes), rhs;
+	double weight = 0.5 / mNumModes;
+	double radius = sqrt((double) mNumModes);
+	
+	for (long j = 0; j < mNumModes; ++j) {
+		for (short sign = -1; sign <= 1; sign += 2) {
+			for (long k = 0; k < mNumModes; ++k)
+				point[k] = mInitialDensity[k].GetParameter(0);
+			
+			point[j] += sign * radius * mInitialDensity[j].GetParameter(1);
+			
+			system.SetCurrentTime(mRunControl.StartTime());
+			system.SetModes(point);
+			system.RHS(rhs);
+			
+			for (short i = 0; i < mNumResolvedModes; ++i) {
+				long m = i + 1;
+				
+				double sum = 0.0;
+				for (long kp = mNumResolvedModes - m + 1; kp <= mNumModes - m; ++kp) {
+					long a = mModeIndex(kp);
+					long b = mModeIndex(m + kp);
+					sum += rhs[a] * point[b] + point[a] * rhs[b];
+				}
+				
+				for (long n = 0; n < numOutputTimes; ++n) {
+					double linearSum = 0.0;
+					for (long kp = mNumResolvedModes - m + 1; kp <= mNumModes - m; ++kp) {
+						long a = mModeIndex(kp);
+						long b = mModeIndex(m + kp);
+						linearSum += mDecay(n, a) * mDecay(n, b) * (rhs[a] * point[b] + point[a] * rhs[b]);
+					}
+					
+					double *mean = mControlMean.Begin() + (n * mNumResolvedModes + i) * mNumControls;
+					mean[0] += weight * 0.5 * m * sum;
+					mean[1] += weight * 0.5 * m * linearSum;
+				}
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+void MKProblem::PrintVarianceReduction() const
+{
+	// variance with the controls over the variance without, per entry
+	double sum = 0.0;
+	double largest = 0.0;
+	for (long i = 0; i < mStatistics.Size(); ++i) {
+		double ratio = mStatistics.VarianceRatio(i);
+		sum += ratio;
+		largest = max(largest, ratio);
+	}
+	
+	cout << "Control variates, variance ratio " << sum / mStatistics.Size() << " on average, " 
+		 << largest << " largest" << endl;
+	
+	return;
+}
+
+
+
+double MKProblem::ComputeStandardError()
+{
+	// per (output time, resolved mode), from the level variances for multilevel runs, the
+	// spread of the replicates for quasi-random sampling and the sample variance otherwise
+	long sampleSize = mRunControl.NumOutputTimes() * mNumResolvedModes;
+	Array<double> error(sampleSize);
+	
+	if (mNumLevels > 1) {
+		for (long e = 0; e < sampleSize; ++e) {
+			double variance = 0.0;
+			for (long l = 0; l < mNumLevels; ++l) {
+				if (mLevelStatistics[l].Count() > 0)
+					variance += mLevelStatistics[l].Variance(e) / mLevelStatistics[l].Count();
+			}
+			
+			error[e] = sqrt(variance);
+		}
+	}
+	else if (mSamplingType == QUASI_RANDOM_SAMPLING) {
+		ReplicateStandardError(mReplicateStatistics, error);
+	}
+	else {
+		for (long e = 0; e < sampleSize; ++e)
+			error[e] = mStatistics.StandardError(e);
+	}
+	
+	double maxError = 0.0;
+	for (long n = 0; n < mRunControl.NumOutputTimes(); ++n) {
+		for (short i = 0; i < mNumResolvedModes; ++i) {
+			mVolterraF0Error(n, i) = error[n * mNumResolvedModes + i];
+			maxError = max(maxError, mVolterraF0Error(n, i));
+		}
+	}
+	
+	return maxError;
+}
+
+
+
+void MKProblem::ComputeQuasiRandomPoints(long firstBlock, long numBlocks)
+{
+	// run r of replicate k is point r of the sequence with the shift of replicate k. the
+	// sampler only restarts (and skips ahead) at a new replicate or after a restart
+	for (long i = 0; i < numBlocks; ++i) {
+		long firstRun = (firstBlock + i) * BlockSize();
+		long replicate = firstRun / mRunsPerReplicate;
+		long index = firstRun % mRunsPerReplicate;
+		
+		if (mQuasiRandomSampler.Replicate() != replicate || mQuasiRandomSampler.Index() != index)
+			mQuasiRandomSampler.Start(replicate, index);
+		
+		for (long run = 0; run < BlockSize(); ++run)
+			mQuasiRandomSampler.Next(mQuasiRandomPoint.Begin() + (i * BlockSize() + run) * mNumModes);
+	}
 	
 	return;
 }
@@ -180,33 +855,131 @@ void MKProblem::Initialize()
 	InitializeRandomNumberGenerator();
 	
 	SetInitialDensities();
+	
+	// variance reduction is for independent samples, and an antithetic pair mustn't
+	// straddle two blocks
+	if ((mAntithetic || mNumControls > 0) && mSamplingType == QUASI_RANDOM_SAMPLING)
+		ThrowException("MKProblem::Initialize : antithetic sampling and control variates need pseudo-random sampling");
+	
+	if (mAntithetic) {
+		if (BlockSize() % 2 != 0)
+			ThrowException("MKProblem::Initialize : antithetic sampling needs an even batch size");
+		
+		mNumMonteCarloRuns += mNumMonteCarloRuns % 2;
+	}
+	
+	// the control means assume the right hand side is quadratic
+	if (mNumControls > 0 && mRunControl.TModelOn())
+		ThrowException("MKProblem::Initialize : control variates don't work with the t-model");
+	
+	// the replicates of quasi-random sampling only give an error once they are all done
+	if (mTargetStandardError > 0.0 && mSamplingType == QUASI_RANDOM_SAMPLING)
+		ThrowException("MKProblem::Initialize : a target standard error needs pseudo-random sampling");
+	
+	// the levels run one System at a time from pseudo-random draws, and a run in progress
+	// is all in the level accumulators
+	if (mNumLevels > 1) {
+		if (mSamplingType == QUASI_RANDOM_SAMPLING || mAntithetic || mNumControls > 0)
+			ThrowException("MKProblem::Initialize : multilevel runs need plain pseudo-random sampling");
+		
+		if (mRunControl.BatchSize() > 0)
+			ThrowException("MKProblem::Initialize : multilevel runs aren't batched");
+		
+		if (mCheckpointFileName.empty() == false || mRestartFileName.empty() == false)
+			ThrowException("MKProblem::Initialize : multilevel runs don't checkpoint");
+	}
+	
+	// the quasi-random runs are rounded up to whole blocks per replicate
+	if (mSamplingType == QUASI_RANDOM_SAMPLING) {
+		long runsPerReplicate = (mNumMonteCarloRuns + mNumReplicates - 1) / mNumReplicates;
+		mRunsPerReplicate = (runsPerReplicate + BlockSize() - 1) / BlockSize() * BlockSize();
+		mNumMonteCarloRuns = mNumReplicates * mRunsPerReplicate;
+		
+		mQuasiRandomSampler.Initialize(mNumModes, mNumReplicates, mpGSLRandomNumberGenerator);
+	}
 				
 	// Volterra coefficients
 	mVolterraF0.SetSize(mRunControl.NumOutputTimes(), mNumResolvedModes);
+	mVolterraF0Error.SetSize(mRunControl.NumOutputTimes(), mNumResolvedModes);
 		
 	// set current time
 	mCurrentTime = mRunControl.StartTime();
 		
-	mSystem.SetSize(1);
+	if (mNumLevels > 1) {
+		InitializeLevels();
+		return;
+	}
 	
-	mSystem[0].SetRunControl(&mRunControl);
-	mSystem[0].SetModeIndex(&mModeIndex);
-	mSystem[0].SetNumModes(mNumModes);
-	mSystem[0].SetOPBEParameter(&mOPBEParameter);
-	mSystem[0].SetCurrentTime(mRunControl.StartTime());
+	// one System per thread
+	long numSystems = mThreadPool.NumThreads();
+	mSystem.SetSize(numSystems);
+	
+	for (long i = 0; i < numSystems; ++i) {
+		mSystem[i].SetRunControl(&mRunControl);
+		mSystem[i].SetModeIndex(&mModeIndex);
+		mSystem[i].SetNumModes(mNumModes);
+		mSystem[i].SetOPBEParameter(&mOPBEParameter);
+		mSystem[i].SetCurrentTime(mRunControl.StartTime());
+	}
 	
 	// initialize all systems
-	mSystem[0].InitializeSolver();
+	for (long i = 0; i < numSystems; ++i)
+		mSystem[i].InitializeSolver();
+	
+	// one batch integrator per thread
+	if (mRunControl.BatchSize() > 0) {
+		mBatchIntegrator.SetSize(numSystems);
+		for (long i = 0; i < numSystems; ++i)
+			mBatchIntegrator[i].Initialize(mRunControl, mOPBEParameter, mNumModes, BlockSize());
+	}
+	
+	if (mNumControls > 0)
+		ComputeControlMeans();
+	
+	
+	return;
+}
+
+
+
+void MKProblem::InitializeLevels()
+{
+	long numThreads = mThreadPool.NumThreads();
+	
+	mLevelModeIndex.SetSize(mNumLevels);
+	mLevelSystem.SetSize(mNumLevels * numThreads);
+	
+	// the solvers read the tolerance when they're initialized
+	double absoluteError = mRunControl.GetLocalAbsoluteError();
+	
+	for (long l = 0; l < mNumLevels; ++l) {
+		mLevelModeIndex[l] = mModeIndex;
+		mLevelModeIndex[l].Set(mLevelModes[l], 0, 0);
+		mLevelModeIndex[l].SetNumResolvedAndUnresolvedModes(mNumResolvedModes, mLevelModes[l] - mNumResolvedModes);
+		
+		mRunControl.SetLocalAbsoluteError(mLevelAbsoluteError[l]);
+		
+		for (long w = 0; w < numThreads; ++w) {
+			System &system = mLevelSystem[l * numThreads + w];
+			system.SetRunControl(&mRunControl);
+			system.SetModeIndex(&mLevelModeIndex[l]);
+			system.SetNumModes(mLevelModes[l]);
+			system.SetOPBEParameter(&mOPBEParameter);
+			system.SetCurrentTime(mRunControl.StartTime());
+			system.InitializeSolver();
+		}
+	}
 	
+	mRunControl.SetLocalAbsoluteError(absoluteError);
 	
 	return;
 }
 
 
 
-double MKProblem::GaussianRandomVariable(double mean, double sigma) const
+double MKProblem::GaussianRandomVariable(gsl_rng *pRNG, double mean, double sigma) const
 {
-	return gsl_ran_gaussian(mpGSLRandomNumberGenerator, sigma) + mean;
+	return gsl_ran_gaussian(pRNG, sigma) + mean;
 }
 
 
@@ -219,23 +992,80 @@ void MKProblem::ReadInputFile(const string &fileName)
 	// find resolved and uresolved modes
 	Parser parser(fileName);
 		
-	// random number generator
-	string rngName;
-	if (parser.FindString("gslrandomnumbergenerator=", rngName))
-		mRunControl.SetGSLRandomNumberGeneratorName(rngName);
-	
-	long randomSeed;
-	if (parser.FindInteger("randomseed=", randomSeed))
-		mRunControl.SetRandomSeed(abs(randomSeed));
+	// run until every entry has a standard error below the target, or the cap is reached
+	if (parser.FindFloat("targetstandarderror=", mTargetStandardError) && mTargetStandardError <= 0.0)
+		ThrowException("MKProblem::ReadInputFile : non-positive target standard error");
 	
 	// number of runs
-	if (parser.FindInteger("numberofruns=", mNumMonteCarloRuns) == false)
-		ThrowException("MKProblem::ReadInputFile : didn't find number of monte carlo runs");
+	if (parser.FindInteger("numberofruns=", mNumMonteCarloRuns) == false) {
+		if (mTargetStandardError <= 0.0)
+			ThrowException("MKProblem::ReadInputFile : didn't find number of monte carlo runs");
+		
+		mNumMonteCarloRuns = DEFAULT_MAX_MONTE_CARLO_RUNS;
+	}
+	
+	// the standard errors go next to the Volterra file
+	string outputName;
+	if (parser.FindFileName("volterraffile=", outputName))
+		mRunControl.OpenOutputStream(VOLTERRA_F0_ERROR_OUTPUT_STREAM, outputName + ".error");
 	
 	// print run count
 	long increment;
 	if (parser.FindInteger("printruncountincrement=", increment))
 		mRunControl.SetPrintRunCountIncrement(increment);
+	
+	// variance reduction
+	string dum;
+	if (parser.FindString("antithetic=on", dum))
+		mAntithetic = true;
+	
+	if (parser.FindString("controlvariates=on", dum))
+		mNumControls = MK_NUM_CONTROL_VARIATES;
+	
+	// multilevel monte carlo over mode truncations and tolerances, the levels default to
+	// numberofmodes and gslabsoluteerror
+	if (parser.FindInteger("numberoflevels=", mNumLevels)) {
+		if (mNumLevels < 2)
+			ThrowException("MKProblem::ReadInputFile : multilevel runs need at least two levels");
+		
+		Array<double> parameter(mNumLevels);
+		mLevelModes.SetSize(mNumLevels);
+		mLevelAbsoluteError.SetSize(mNumLevels);
+		
+		bool foundModes = parser.FindBracedFloats("levelmodes={", parameter);
+		for (long l = 0; l < mNumLevels; ++l)
+			mLevelModes[l] = foundModes ? NearestInteger(parameter[l]) : mNumModes;
+		
+		bool foundErrors = parser.FindBracedFloats("levelabsoluteerror={", parameter);
+		for (long l = 0; l < mNumLevels; ++l)
+			mLevelAbsoluteError[l] = foundErrors ? parameter[l] : mRunControl.GetLocalAbsoluteError();
+		
+		if (foundModes == false && foundErrors == false)
+			ThrowException("MKProblem::ReadInputFile : didn't find levelmodes or levelabsoluteerror");
+		
+		for (long l = 0; l < mNumLevels; ++l) {
+			if (mLevelModes[l] <= mNumResolvedModes || (l > 0 && mLevelModes[l] < mLevelModes[l - 1]))
+				ThrowException("MKProblem::ReadInputFile : level modes should increase and exceed the resolved modes");
+			
+			if (mLevelAbsoluteError[l] <= 0.0)
+				ThrowException("MKProblem::ReadInputFile : non-positive level absolute error");
+		}
+		
+		if (mLevelModes[mNumLevels - 1] != mNumModes)
+			ThrowException("MKProblem::ReadInputFile : the finest level should have numberofmodes modes");
+		
+		if (parser.FindInteger("levelpilotruns=", mNumPilotRuns) && mNumPilotRuns < 2)
+			ThrowException("MKProblem::ReadInputFile : need at least two pilot runs per level");
+		
+		// fixed costs per run (any unit) make the allocation reproducible
+		if (parser.FindBracedFloats("levelcost={", parameter)) {
+			mLevelCost = parameter;
+			for (long l = 0; l < mNumLevels; ++l) {
+				if (mLevelCost[l] <= 0.0)
+					ThrowException("MKProblem::ReadInputFile : non-positive level cost");
+			}
+		}
+	}
 		
 		
 	return;
@@ -265,8 +1095,16 @@ void MKProblem::SetInitialDensities()
 
 void MKProblem::WriteVolterraFFile() 
 {
-	ofstream& fileStream = mRunControl.GetOutputStream(VOLTERRA_F0_OUTPUT_STREAM);
+	WriteVolterraMatrix(mRunControl.GetOutputStream(VOLTERRA_F0_OUTPUT_STREAM), mVolterraF0);
+	WriteVolterraMatrix(mRunControl.GetOutputStream(VOLTERRA_F0_ERROR_OUTPUT_STREAM), mVolterraF0Error);
+	
+	return;
+}
 
+
+
+void MKProblem::WriteVolterraMatrix(ofstream &fileStream, const Matrix<double> &matrix) const
+{
 	if (fileStream.is_open() == false)
 		return;
 	
@@ -274,7 +1112,7 @@ void MKProblem::WriteVolterraFFile()
 		fileStream << mRunControl.OutputTime(n) << " ";
 		
 		for (short i = 0; i < mNumResolvedModes; ++i) {
-			fileStream << mVolterraF0(n, i);
+			fileStream << matrix(n, i);
 			
 			if (i != mNumResolvedModes - 1)
 				fileStream << " ";
@@ -289,6 +1127,45 @@ void MKProblem::WriteVolterraFFile()
 
 
 
+void MKProblem::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	// each block seeds its own generator from its index, so the merged accumulator
+	// is all there is to save, and a restart may use a different number of threads
+	checkpoint.WriteInteger(mNumMonteCarloRuns);
+	checkpoint.WriteInteger(BlockSize());
+	checkpoint.WriteInteger(RunsPerSample());
+	mStatistics.WriteCheckpoint(checkpoint);
+	
+	checkpoint.WriteInteger(mReplicateStatistics.Size());
+	for (long r = 0; r < mReplicateStatistics.Size(); ++r)
+		mReplicateStatistics[r].WriteCheckpoint(checkpoint);
+	
+	return;
+}
+
+
+
+void MKProblem::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	if (checkpoint.ReadInteger() != mNumMonteCarloRuns || checkpoint.ReadInteger() != BlockSize())
+		ThrowException("MKProblem::ReadCheckpoint : checkpoint has a different number of runs or block size");
+	
+	if (checkpoint.ReadInteger() != RunsPerSample())
+		ThrowException("MKProblem::ReadCheckpoint : checkpoint has a different antithetic sampling");
+	
+	mStatistics.ReadCheckpoint(checkpoint);
+	
+	if (checkpoint.ReadInteger() != mReplicateStatistics.Size())
+		ThrowException("MKProblem::ReadCheckpoint : checkpoint has a different sampling or number of replicates");
+	
+	for (long r = 0; r < mReplicateStatistics.Size(); ++r)
+		mReplicateStatistics[r].ReadCheckpoint(checkpoint);
+	
+	return;
+}
+
+
+
 void MKProblem::Test(const string &fileName)
 {
 	// read input file
@@ -298,7 +1175,7 @@ void MKProblem::Test(const string &fileName)
 	Initialize();
 	
 	for (short i = 0; i < 1000; ++i)
-		cout << GaussianRandomVariable(1.0, 0.1) << endl;
+		cout << GaussianRandomVariable(mpGSLRandomNumberGenerator, 1.0, 0.1) << endl;
 	
     return;
 }
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "outputpipeline.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+OutputPipeline::OutputPipeline(const OutputPipeline &pipeline)
+{
+	ThrowException("OutputPipeline : copy constructor not implemented");
+	return;
+}
+
+
+
+void OutputPipeline::Initialize(ConsumeFunction consume, void *params, long numSlots, long snapshotSize)
+{
+	if (consume == NULL)
+		ThrowException("OutputPipeline::Initialize : no consume function");
+	
+	if (numSlots <= 0 || snapshotSize < 0)
+		ThrowException("OutputPipeline::Initialize : bad number of slots or snapshot size");
+	
+	CleanUp();
+	
+	mConsume = consume;
+	mpParams = params;
+	
+	// all the snapshot memory is allocated here
+	mSlot.SetSize(numSlots);
+	for (long i = 0; i < numSlots; ++i) {
+		mSlot[i].mTime = 0.0;
+		mSlot[i].mMode.SetSize(snapshotSize);
+	}
+	
+	mHead = 0;
+	mTail = 0;
+	mStop = false;
+	mFailed = false;
+	mException = exception_ptr();
+	
+	mThread = thread(&OutputPipeline::WriterLoop, this);
+	
+	return;
+}
+
+
+
+OutputSnapshot &OutputPipeline::AcquireSlot()
+{
+	if (Running() == false)
+		ThrowException("OutputPipeline::AcquireSlot : not running");
+	
+	unsigned long numSlots = mSlot.Size();
+	unsigned long tail = mTail.load(memory_order_relaxed);
+	
+	// backpressure, wait for the writer to free a slot
+	if (tail - mHead.load(memory_order_acquire) == numSlots) {
+		unique_lock<mutex> lock(mMutex);
+		mNotFull.wait(lock, [&] { return tail - mHead.load(memory_order_acquire) < numSlots; });
+	}
+	
+	return mSlot[tail % numSlots];
+}
+
+
+
+void OutputPipeline::Publish()
+{
+	RethrowWriterException();
+	
+	mTail.store(mTail.load(memory_order_relaxed) + 1, memory_order_release);
+	
+	// taking the lock orders the store before a writer that is about to sleep
+	{
+		lock_guard<mutex> lock(mMutex);
+	}
+	mNotEmpty.notify_one();
+	
+	return;
+}
+
+
+
+void OutputPipeline::Drain()
+{
+	if (Running() == false)
+		return;
+	
+	WaitUntilEmpty();
+	RethrowWriterException();
+	
+	return;
+}
+
+
+
+void OutputPipeline::Finish()
+{
+	if (Running() == false)
+		return;
+	
+	WaitUntilEmpty();
+	CleanUp();
+	RethrowWriterException();
+	
+	return;
+}
+
+
+
+void OutputPipeline::WaitUntilEmpty()
+{
+	// the writer notifies mNotFull after each snapshot
+	unique_lock<mutex> lock(mMutex);
+	mNotFull.wait(lock, [&] { return mHead.load(memory_order_acquire) == mTail.load(memory_order_relaxed); });
+	
+	return;
+}
+
+
+
+void OutputPipeline::CleanUp()
+{
+	if (Running() == false)
+		return;
+	
+	// the writer finishes the published snapshots before it stops
+	{
+		lock_guard<mutex> lock(mMutex);
+		mStop = true;
+	}
+	mNotEmpty.notify_one();
+	
+	mThread.join();
+	
+	return;
+}
+
+
+
+void OutputPipeline::WriterLoop()
+{
+	unsigned long numSlots = mSlot.Size();
+	
+	while (true) {
+		unsigned long head = mHead.load(memory_order_relaxed);
+		
+		if (mTail.load(memory_order_acquire) == head) {
+			unique_lock<mutex> lock(mMutex);
+			mNotEmpty.wait(lock, [&] { return mTail.load(memory_order_acquire) != head || mStop; });
+			
+			if (mTail.load(memory_order_acquire) == head)
+				break;
+		}
+		
+		if (mFailed.load(memory_order_relaxed) == false) {
+			try {
+				mConsume(mSlot[head % numSlots], mpParams);
+			}
+			catch (...) {
+				mException = current_exception();
+				mFailed.store(true, memory_order_release);
+			}
+		}
+		
+		mHead.store(head + 1, memory_order_release);
+		
+		{
+			lock_guard<mutex> lock(mMutex);
+		}
+		mNotFull.notify_one();
+	}
+	
+	return;
+}
+
+
+
+void OutputPipeline::RethrowWriterException()
+{
+	// the writer never touches mException again once mFailed is set. the failure is
+	// reported once, and the snapshots after it are dropped
+	if (mFailed.load(memory_order_acquire) == false || mException == exception_ptr())
+		return;
+	
+	exception_ptr exception = mException;
+	mException = exception_ptr();
+	
+	rethrow_exception(exception);
+	
+	return;
+}
@@ -30,6 +30,32 @@
 using namespace NAMESPACE;
 using namespace std;
 
+namespace NAMESPACE {
+	// evolves one System per task
+	class EvolveTask : public ThreadPoolTask {
+	 public:
+		EvolveTask(Array<System> &system, double t1) : mSystem(system), mT1(t1) { };
+		void Execute(long taskIndex, long worker) {mSystem[taskIndex].Evolve(mT1);}
+		
+	 private:
+		Array<System> &mSystem;
+		double mT1;
+	};
+	
+	
+	
+	// evolves one batch of systems per task
+	class EvolveBatchTask : public ThreadPoolTask {
+	 public:
+		EvolveBatchTask(Problem &problem, double t1) : mProblem(problem), mT1(t1) { };
+		void Execute(long taskIndex, long worker) {mProblem.EvolveBatch(taskIndex, mT1);}
+		
+	 private:
+		Problem &mProblem;
+		double mT1;
+	};
+}
+
 Problem::Problem(const Problem &sol)
 {
 	ThrowException("Problem : copy constructor not implemented");
@@ -40,9 +66,20 @@ Problem::Problem(const Problem &sol)
 
 void Problem::Evolve(double t1)
 {
-	// evolve all systems from current time to t1
-	for (long i = 0; i < mSystem.Size(); ++i) 
-		mSystem[i].Evolve(t1);
+	// evolve all systems from current time to t1, the systems are independent
+	// so they can be evolved on the thread pool
+	if (mRunControl.BatchSize() > 0) {
+		long batchSize = mRunControl.BatchSize();
+		if (mBatchIntegrator.Size() != (mSystem.Size() + batchSize - 1) / batchSize)
+			InitializeBatchIntegrators();
+		
+		EvolveBatchTask task(*this, t1);
+		mThreadPool.Run(task, mBatchIntegrator.Size());
+	}
+	else {
+		EvolveTask task(mSystem, t1);
+		mThreadPool.Run(task, mSystem.Size());
+	}
 		
 	mCurrentTime = t1;
 	mState = PROBLEM_RUNNING;
@@ -53,6 +90,48 @@ void Problem::Evolve(double t1)
 
 
 
+void Problem::InitializeBatchIntegrators()
+{
+	// systems 0, ..., B - 1 go in the first batch, and so on, the last batch may be smaller
+	long batchSize = mRunControl.BatchSize();
+	long numBatches = (mSystem.Size() + batchSize - 1) / batchSize;
+	
+	mBatchIntegrator.SetSize(numBatches);
+	
+	for (long i = 0; i < numBatches; ++i) {
+		long size = min(batchSize, mSystem.Size() - i * batchSize);
+		mBatchIntegrator[i].Initialize(mRunControl, mOPBEParameter, mNumModes, size);
+	}
+	
+	return;
+}
+
+
+
+void Problem::EvolveBatch(long batch, double t1)
+{
+	// the systems hold the state between calls, the integrator only the step size
+	BatchIntegrator &integrator = mBatchIntegrator[batch];
+	long first = batch * mRunControl.BatchSize();
+	
+	for (long b = 0; b < integrator.BatchSize(); ++b)
+		integrator.SetMember(b, mSystem[first + b].Modes().Begin());
+	
+	double t = mSystem[first].CurrentTime();
+	integrator.Evolve(t, t1);
+	
+	Array<double> modes(mNumModes);
+	for (long b = 0; b < integrator.BatchSize(); ++b) {
+		integrator.GetMember(b, modes.Begin());
+		mSystem[first + b].SetModes(modes);
+		mSystem[first + b].SetCurrentTime(t);
+	}
+	
+	return;
+}
+
+
+
 void Problem::Reset()
 {
 	// set current time
@@ -62,6 +141,9 @@ void Problem::Reset()
 		mSystem[i].SetCurrentTime(mRunControl.StartTime());
 		mSystem[i].SetToInitialCondition();
 	}
+	
+	for (long i = 0; i < mBatchIntegrator.Size(); ++i)
+		mBatchIntegrator[i].Reset();
 
 	return;
 }
@@ -167,10 +249,60 @@ void Problem::ReadInputFile(const string &fileName)
 	if (parser.FindString("t-model=on", dum)) 
 		mRunControl.TurnOnTModel();
 	
-	// gsl solver
+	// gsl solver, without one the imex solver is used for stiff Burgers runs (it only
+	// knows the Burgers linear term)
 	string solverName;
-	parser.FindString("gslsolver=", solverName);
-	mRunControl.SetGSLSolverName(solverName);
+	if (parser.FindString("gslsolver=", solverName))
+		mRunControl.SetGSLSolverName(solverName);
+	else if (mRunControl.GetSystemType() == BURGERS_EQUATION && 
+			 mOPBEParameter.ViscosityCoefficient() * mNumModes * mNumModes > STIFF_SOLVER_THRESHOLD)
+		mRunControl.SetGSLSolverName(DEFAULT_STIFF_SOLVER);
+	else
+		mRunControl.SetGSLSolverName(DEFAULT_GSL_SOLVER);
+	
+	// time step for the fixed step solvers (etdrk4)
+	double timeStep;
+	if (parser.FindFloat("timestep=", timeStep))
+		mRunControl.SetTimeStep(timeStep);
+	
+	// step past the output times and interpolate
+	if (parser.FindString("denseoutput=on", dum))
+		mRunControl.TurnOnDenseOutput();
+	
+	// right hand side evaluation, direct convolution or fft
+	string rhsMethod;
+	if (parser.FindString("rhsmethod=", rhsMethod))
+		mRunControl.SetRHSMethod(rhsMethod);
+	
+	// threads for evolving the systems
+	long numThreads;
+	if (parser.FindInteger("numthreads=", numThreads))
+		mRunControl.SetNumThreads(numThreads);
+	
+	mThreadPool.Initialize(mRunControl.NumThreads());
+	
+	// evolve the systems in batches
+	long batchSize;
+	if (parser.FindInteger("batchsize=", batchSize))
+		mRunControl.SetBatchSize(batchSize);
+	
+	// a batch shares one explicit Cash-Karp step with the direct right hand side, so it
+	// can't stand in for an implicit solver, or step past output times
+	if (mRunControl.BatchSize() > 0) {
+		string name = mRunControl.SolverName();
+		if (name != "rk2" && name != "rk4" && name != "rkf45" && name != "rkck" && name != "rk8pd" && name != "dopri5")
+			ThrowException("Problem::ReadInputFile : batchsize needs an explicit solver, not " + name + 
+						   " (set gslsolver= to an explicit one)");
+		
+		if (mRunControl.DenseOutputOn())
+			ThrowException("Problem::ReadInputFile : batchsize doesn't work with dense output");
+		
+		cout << "Batches use the Cash-Karp solver with the direct right hand side";
+		if (name != "rkck" || mRunControl.GetRHSMethod() != DIRECT_RHS)
+			cout << ", gslsolver= and rhsmethod= are ignored";
+		
+		cout << endl;
+	}
 	
 	double odeError;
 	if (parser.FindFloat("gslrelativeerror=", odeError))
@@ -213,9 +345,23 @@ void Problem::ReadInputFile(const string &fileName)
 	}
 	cout << "Output directory is " + mRunControl.OutputDirectory() << endl;
 	
-	// open output file streams
-	if (parser.FindFileName("modefile=", outputName)) 
-		mRunControl.OpenOutputStream(MODE_OUTPUT_STREAM, outputName);
+	// a restart continues the output files of the run it restarts
+	if (parser.FindFileName("restartfile=", outputName)) {
+		mRestartFileName = mRunControl.OutputDirectory() + outputName;
+		mRunControl.TurnOnAppendOutput();
+	}
+	
+	// open output file streams, a binary mode file is opened once the number of systems is known
+	string modeFileFormat;
+	if (parser.FindString("modefileformat=", modeFileFormat))
+		mRunControl.SetModeFileFormat(modeFileFormat);
+	
+	if (parser.FindFileName("modefile=", outputName)) {
+		if (mRunControl.GetModeFileFormat() == TEXT_MODE_FILE)
+			mRunControl.OpenOutputStream(MODE_OUTPUT_STREAM, outputName);
+		else
+			mModeFileName = mRunControl.OutputDirectory() + outputName;
+	}
 	
 	if (parser.FindFileName("energyfile=", outputName)) 
 		mRunControl.OpenOutputStream(ENERGY_OUTPUT_STREAM, outputName);
@@ -229,10 +375,46 @@ void Problem::ReadInputFile(const string &fileName)
 	if (parser.FindFileName("volterraffile=", outputName))
 		mRunControl.OpenOutputStream(VOLTERRA_F0_OUTPUT_STREAM, outputName);
 		
+	// random number generator
+	string rngName;
+	if (parser.FindString("gslrandomnumbergenerator=", rngName))
+		mRunControl.SetGSLRandomNumberGeneratorName(rngName);
+	
+	long randomSeed;
+	if (parser.FindInteger("randomseed=", randomSeed))
+		mRunControl.SetRandomSeed(abs(randomSeed));
+	
+	// pseudo- or quasi-random sampling of the initial densities
+	string samplingType;
+	if (parser.FindString("sampling=", samplingType))
+		SetSamplingType(samplingType);
+	
+	if (parser.FindInteger("numberofreplicates=", mNumReplicates) && mNumReplicates < 2)
+		ThrowException("Problem::ReadInputFile : at least two replicates are needed for an error estimate");
+	
+	// checkpoints, in the output directory. they are only taken at output times and
+	// between blocks of runs, so the interval is a lower bound on the time between them
+	if (parser.FindFileName("checkpointfile=", outputName))
+		mCheckpointFileName = mRunControl.OutputDirectory() + outputName;
+	
+	if (parser.FindFloat("checkpointinterval=", mCheckpointInterval) && mCheckpointInterval < 0.0)
+		ThrowException("Problem::ReadInputFile : negative checkpoint interval");
+	
+	if (mCheckpointFileName.empty() == false)
+		cout << "Checkpoints at the first output time or block of runs after every " << mCheckpointInterval << " seconds" << endl;
+	
+	// write the output on its own thread
+	if (parser.FindString("asyncoutput=on", dum))
+		mRunControl.TurnOnAsyncOutput();
+	
 	// clock
 	if (parser.FindString("runclock=on", dum))
 		mRunControl.TurnOnRunClock();
 		
+	// time the right hand sides and solvers instead of running (fixed initial conditions)
+	if (parser.FindString("benchmark=on", dum))
+		mRunControl.TurnOnBenchmark();
+	
 	// print run time
 	if (parser.FindString("printruntime=on", dum))
 		mRunControl.TurnOnRunClock();
@@ -302,15 +484,112 @@ void Problem::ReadInitialConditions(const std::string &fileName)
 
 void Problem::InitializeRandomNumberGenerator()
 {	
+	mpGSLRandomNumberGenerator = AllocateRandomNumberGenerator();
+	gsl_rng_set(mpGSLRandomNumberGenerator, mRunControl.RandomSeed());
+	
+	
+	return;
+}
+
+
+
+gsl_rng *Problem::AllocateRandomNumberGenerator() const
+{
+	gsl_rng *pRNG = NULL;
+	
 	string rngName = mRunControl.RandomNumberGeneratorName();
 	if (rngName == "taus")
-		mpGSLRandomNumberGenerator = gsl_rng_alloc(gsl_rng_taus);
+		pRNG = gsl_rng_alloc(gsl_rng_taus);
 					
-	if (mpGSLRandomNumberGenerator == NULL)
+	if (pRNG == NULL)
 		ThrowException("Problem : random number generator initialization failed for type " + rngName);
 	
-	gsl_rng_set(mpGSLRandomNumberGenerator, mRunControl.RandomSeed());
+	return pRNG;
+}
+
+
+
+unsigned long int Problem::StreamSeed(unsigned long int stream) const
+{
+	// seed for an independent random number stream, derived from the random seed and the
+	// stream number with the splitmix64 finalizer, so nearby streams get unrelated seeds
+	unsigned long long z = mRunControl.RandomSeed() + 0x9E3779B97F4A7C15ULL * (stream + 1);
+	
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	
+	return (unsigned long int) z;
+}
+
+
+
+void Problem::SetSamplingType(const string &samplingType)
+{
+	if (samplingType == "pseudorandom") {
+		mSamplingType = PSEUDO_RANDOM_SAMPLING;
+		return;
+	}
+	
+	if (samplingType == "quasirandom") {
+		mSamplingType = QUASI_RANDOM_SAMPLING;
+		return;
+	}
+	
+	ThrowException("Problem::SetSamplingType : no type corresponds to string " + samplingType);
+	
+	return;
+}
+
+
+
+double Problem::ReplicateStandardError(const Array<RunningStatistics> &replicate, Array<double> &error) const
+{
+	// the replicate means are independent and identically distributed, so the standard
+	// error of their mean is their sample standard deviation over the square root of
+	// the number of replicates
+	long numReplicates = replicate.Size();
+	if (numReplicates < 2)
+		ThrowException("Problem::ReplicateStandardError : at least two replicates are needed");
+	
+	long size = replicate[0].Size();
+	error.SetSize(size);
+	
+	double maxError = 0.0;
+	for (long i = 0; i < size; ++i) {
+		double mean = 0.0;
+		for (long r = 0; r < numReplicates; ++r)
+			mean += replicate[r].Mean(i);
+		
+		mean /= numReplicates;
+		
+		double variance = 0.0;
+		for (long r = 0; r < numReplicates; ++r)
+			variance += (replicate[r].Mean(i) - mean) * (replicate[r].Mean(i) - mean);
+		
+		variance /= numReplicates - 1.0;
+		
+		error[i] = sqrt(variance / numReplicates);
+		maxError = max(maxError, error[i]);
+	}
 	
+	return maxError;
+}
+
+
+
+void Problem::PrintReplicateError(const Array<RunningStatistics> &replicate) const
+{
+	Array<double> error;
+	double maxError = ReplicateStandardError(replicate, error);
+	
+	if (mSamplingType == QUASI_RANDOM_SAMPLING)
+		cout << "Randomized quasi-Monte Carlo (" << mQuasiRandomSampler.SequenceName() << "), ";
+	else
+		cout << "Monte Carlo, ";
+	
+	cout << replicate.Size() << " replicates of " << replicate[0].Count() << " points, "
+		 << "largest standard error " << maxError << endl;
 	
 	return;
 }
@@ -321,53 +600,171 @@ void Problem::WriteOutput()
 {
 	if (mRunControl.PrintOutputTime())
 		cout << "time " << mCurrentTime << endl;
-		
-	WriteModes();
-	WriteEnergy();
-	WriteMoments();
-	WriteTModelRatio();
+	
+	long snapshotSize = mSystem.Size() * mNumModes;
+	
+	if (mRunControl.AsyncOutputOn() && mOutputPipeline.Running() == false)
+		mOutputPipeline.Initialize(ConsumeSnapshot, this, OUTPUT_QUEUE_SIZE, snapshotSize);
+	
+	OutputSnapshot &snapshot = mOutputPipeline.Running() ? mOutputPipeline.AcquireSlot() : mSnapshot;
+	
+	snapshot.mTime = mCurrentTime;
+	if (snapshot.mMode.Size() != snapshotSize)
+		snapshot.mMode.SetSize(snapshotSize);
+	
+	for (long s = 0; s < mSystem.Size(); ++s) {
+		const Array<double> &mode = mSystem[s].Modes();
+		for (long i = 0; i < mNumModes; ++i)
+			snapshot.mMode[s * mNumModes + i] = mode[i];
+	}
+	
+	if (mOutputPipeline.Running())
+		mOutputPipeline.Publish();
+	else
+		WriteSnapshot(snapshot);
+	
+	return;
+}
+
+
+
+void Problem::FinishOutput()
+{
+	// waits for the output pipeline, then closes the binary mode file
+	mOutputPipeline.Finish();
+	mTrajectoryWriter.Close();
+	mChunkedWriter.Close();
+	
+	return;
+}
+
+
+
+void Problem::ConsumeSnapshot(const OutputSnapshot &snapshot, void *params)
+{
+	((Problem *) params)->WriteSnapshot(snapshot);
+	return;
+}
+
+
+
+void Problem::WriteSnapshot(const OutputSnapshot &snapshot)
+{
+	// runs on the output pipeline thread when the output is asynchronous, so it only
+	// touches the snapshot, mOutputSystem and the output streams
+	if (mOutputSystem.Modes().Size() != mNumModes) {
+		mOutputSystem.SetRunControl(&mRunControl);
+		mOutputSystem.SetModeIndex(&mModeIndex);
+		mOutputSystem.SetOPBEParameter(&mOPBEParameter);
+		mOutputSystem.SetNumModes(mNumModes);
+	}
+	
+	// the diagnostics are only written for the first system
+	Array<double> first(mNumModes);
+	for (long i = 0; i < mNumModes; ++i)
+		first[i] = snapshot.mMode[i];
+	
+	mOutputSystem.SetCurrentTime(snapshot.mTime);
+	mOutputSystem.SetModes(first);
+	
+	WriteModes(snapshot);
+	WriteEnergy(snapshot.mTime, mOutputSystem);
+	WriteMoments(snapshot.mTime, mOutputSystem);
+	WriteTModelRatio(snapshot.mTime, mOutputSystem);
 	
 	return;
 }
 
 
 
-void Problem::WriteModes()
+void Problem::WriteModes(const OutputSnapshot &snapshot)
 {
+	if (mRunControl.GetModeFileFormat() != TEXT_MODE_FILE) {
+		WriteBinaryModes(snapshot);
+		return;
+	}
+	
 	ofstream& fileStream = mRunControl.GetOutputStream(MODE_OUTPUT_STREAM);
 
 	if (fileStream.is_open() == false)
 		return;
-
-	for (long s = 0; s < mSystem.Size(); ++s) {
-		fileStream << mCurrentTime << " ";
+	
+	long numSystems = snapshot.mMode.Size() / mNumModes;
+	
+	for (long s = 0; s < numSystems; ++s) {
+		fileStream << snapshot.mTime << " ";
 		
 		for (long i = 0; i < mNumModes; ++i) {
-			fileStream << setprecision(10) << mSystem[s].GetMode(i);
+			fileStream << setprecision(10) << snapshot.mMode[s * mNumModes + i];
 			if (i != mNumModes - 1)
 				fileStream << " ";
 		}
 	}
 	
-	fileStream << endl;
+	fileStream << "\n";
 	
 	return;
 }
 
 
 
-void Problem::WriteEnergy()
+void Problem::WriteBinaryModes(const OutputSnapshot &snapshot)
 {
-	// currently writes only the energy of mSystem[0] to the output stream
+	if (mModeFileName.empty())
+		return;
+	
+	long numSystems = snapshot.mMode.Size() / mNumModes;
+	
+	if (mRunControl.GetModeFileFormat() == CHUNKED_MODE_FILE) {
+		if (mChunkedWriter.IsOpen() == false) {
+			Array<double> time(mRunControl.NumOutputTimes());
+			for (long n = 0; n < time.Size(); ++n)
+				time[n] = mRunControl.OutputTime(n);
+			
+			if (mNumOutputTimesWritten > 0)
+				mChunkedWriter.Resume(mModeFileName, mNumModes, numSystems, time, mNumOutputTimesWritten);
+			else
+				mChunkedWriter.Open(mModeFileName, mNumModes, numSystems, time);
+		}
+		
+		for (long s = 0; s < numSystems; ++s)
+			mChunkedWriter.Write(snapshot.mMode.Begin() + s * mNumModes);
+		
+		return;
+	}
+	
+	if (mTrajectoryWriter.IsOpen() == false) {
+		Array<double> time(mRunControl.NumOutputTimes());
+		for (long n = 0; n < time.Size(); ++n)
+			time[n] = mRunControl.OutputTime(n);
+		
+		bool singlePrecision = (mRunControl.GetModeFileFormat() == BINARY32_MODE_FILE);
+		if (mNumOutputTimesWritten > 0)
+			mTrajectoryWriter.Resume(mModeFileName, mNumModes, numSystems, time, singlePrecision, mNumOutputTimesWritten);
+		else
+			mTrajectoryWriter.Open(mModeFileName, mNumModes, numSystems, time, singlePrecision);
+	}
+	
+	for (long s = 0; s < numSystems; ++s)
+		mTrajectoryWriter.Write(snapshot.mMode.Begin() + s * mNumModes);
+	
+	return;
+}
+
+
+
+void Problem::WriteEnergy(double t, const System &system)
+{
+	// currently writes only the energy of the first system to the output stream
 	
 	ofstream& fileStream = mRunControl.GetOutputStream(ENERGY_OUTPUT_STREAM);
 
 	if (fileStream.is_open() == false)
 		return;
 		 
-	fileStream << mCurrentTime << " ";
+	fileStream << t << " ";
 	
-	fileStream << mSystem[0].Energy() << " " << mSystem[0].Energy(mNumResolvedModes) << endl;
+	fileStream << system.Energy() << " " << system.Energy(mNumResolvedModes) << endl;
 	
 
 	return;
@@ -375,18 +772,18 @@ void Problem::WriteEnergy()
 
 
 
-void Problem::WriteMoments()
+void Problem::WriteMoments(double t, const System &system)
 {
-	// writes only moments of mSystem[0] to file
+	// writes only moments of the first system to file
 	ofstream& fileStream = mRunControl.GetOutputStream(MOMENTS_OUTPUT_STREAM);
 
 	if (fileStream.is_open() == false)
 		return;
 
-	fileStream << mCurrentTime << " ";
+	fileStream << t << " ";
 	
 	Array<double> moment;
-	mSystem[0].ComputeMoments(moment, DEFAULT_NUM_MOMENTS);
+	system.ComputeMoments(moment, DEFAULT_NUM_MOMENTS);
 	
 	for (short m = 1; m <= DEFAULT_NUM_MOMENTS; ++m) {
 		fileStream << moment[m]; " ";
@@ -402,7 +799,7 @@ void Problem::WriteMoments()
 
 
 
-void Problem::WriteTModelRatio()
+void Problem::WriteTModelRatio(double t, const System &system)
 {
 	ofstream& fileStream = mRunControl.GetOutputStream(TMODEL_RATIO_OUTPUT_STREAM);
 
@@ -410,9 +807,9 @@ void Problem::WriteTModelRatio()
 		return;
 
 	Array<double> ratio;
-	mSystem[0].RatioTModel(ratio);
+	system.RatioTModel(ratio);
 	
-	fileStream << mCurrentTime << " ";
+	fileStream << t << " ";
 		
 	for (long i = 0; i < mNumModes; ++i) {
 		fileStream << ratio[i];
@@ -432,4 +829,123 @@ void Problem::PrintCurrentTime() const
 	cout << "t = " << mCurrentTime << endl;
 	
 	return;
-}
\ No newline at end of file
+}
+
+
+
+bool Problem::CheckpointDue() const
+{
+	// polled at output times and block boundaries only, a checkpoint taken inside the
+	// step loop would need to stop the adaptive steps there and change the results
+	if (mCheckpointFileName.empty())
+		return false;
+	
+	return difftime(time(NULL), mLastCheckpointTime) >= mCheckpointInterval;
+}
+
+
+
+void Problem::SaveCheckpoint(long position)
+{
+	// the output up to position has to be on disk before the checkpoint says so
+	mOutputPipeline.Drain();
+	mTrajectoryWriter.Flush();
+	mChunkedWriter.Flush();
+	
+	Checkpoint checkpoint;
+	checkpoint.WriteInteger(mNumModes);
+	checkpoint.WriteInteger(position);
+	checkpoint.WriteDouble(mCurrentTime);
+	
+	checkpoint.WriteInteger(mpGSLRandomNumberGenerator != NULL);
+	if (mpGSLRandomNumberGenerator != NULL)
+		checkpoint.WriteRandomNumberGenerator(mpGSLRandomNumberGenerator);
+	
+	// the size of each text output stream, a restart cuts it back to that
+	for (short s = 0; s < END_OUTPUT_STREAM; ++s)
+		checkpoint.WriteInteger(mRunControl.OutputStreamSize((OutputFileStreamType) s));
+	
+	WriteCheckpoint(checkpoint);
+	
+	checkpoint.Save(mCheckpointFileName);
+	mLastCheckpointTime = time(NULL);
+	
+	return;
+}
+
+
+
+long Problem::RestoreCheckpoint()
+{
+	if (mRestartFileName.empty())
+		return 0;
+	
+	Checkpoint checkpoint;
+	checkpoint.Load(mRestartFileName);
+	
+	if (checkpoint.ReadInteger() != mNumModes)
+		ThrowException("Problem::RestoreCheckpoint : " + mRestartFileName + " has a different number of modes");
+	
+	long position = checkpoint.ReadInteger();
+	mCurrentTime = checkpoint.ReadDouble();
+	
+	bool randomNumberGenerator = (checkpoint.ReadInteger() != 0);
+	if (randomNumberGenerator != (mpGSLRandomNumberGenerator != NULL))
+		ThrowException("Problem::RestoreCheckpoint : " + mRestartFileName + " is from another problem type");
+	
+	if (randomNumberGenerator)
+		checkpoint.ReadRandomNumberGenerator(mpGSLRandomNumberGenerator);
+	
+	for (short s = 0; s < END_OUTPUT_STREAM; ++s)
+		mRunControl.TruncateOutputStream((OutputFileStreamType) s, checkpoint.ReadInteger());
+	
+	ReadCheckpoint(checkpoint);
+	
+	if (checkpoint.AtEnd() == false)
+		ThrowException("Problem::RestoreCheckpoint : " + mRestartFileName + " is from another problem type");
+	
+	mState = PROBLEM_RUNNING;
+	cout << "Restarting from " + mRestartFileName + " at time " << mCurrentTime << endl;
+	
+	return position;
+}
+
+
+
+void Problem::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	// the systems, and the step sizes of the batch integrators
+	checkpoint.WriteInteger(mSystem.Size());
+	for (long i = 0; i < mSystem.Size(); ++i)
+		mSystem[i].WriteCheckpoint(checkpoint);
+	
+	checkpoint.WriteInteger(mBatchIntegrator.Size());
+	for (long i = 0; i < mBatchIntegrator.Size(); ++i)
+		checkpoint.WriteDouble(mBatchIntegrator[i].StepSize());
+	
+	return;
+}
+
+
+
+void Problem::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	if (checkpoint.ReadInteger() != mSystem.Size())
+		ThrowException("Problem::ReadCheckpoint : checkpoint has a different number of systems");
+	
+	for (long i = 0; i < mSystem.Size(); ++i)
+		mSystem[i].ReadCheckpoint(checkpoint);
+	
+	long numBatches = checkpoint.ReadInteger();
+	if (numBatches > 0 && mRunControl.BatchSize() > 0 && mBatchIntegrator.Size() == 0)
+		InitializeBatchIntegrators();
+	
+	if (numBatches != mBatchIntegrator.Size())
+		ThrowException("Problem::ReadCheckpoint : checkpoint was written with a different batch size");
+	
+	for (long i = 0; i < numBatches; ++i)
+		mBatchIntegrator[i].SetStepSize(checkpoint.ReadDouble());
+	
+	return;
+}
+
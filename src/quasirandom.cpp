@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quasirandom.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+// dimensions gsl_qrng_sobol supports
+static const long SOBOL_MAX_DIMENSION = 40;
+
+static const double TWO_TO_32 = 4294967296.0;
+
+QuasiRandomSampler::QuasiRandomSampler(const QuasiRandomSampler &sampler)
+{
+	ThrowException("QuasiRandomSampler : copy constructor not implemented");
+	return;
+}
+
+
+
+void QuasiRandomSampler::Initialize(long dimension, long numReplicates, gsl_rng *pRNG)
+{
+	if (dimension <= 0 || numReplicates <= 0)
+		ThrowException("QuasiRandomSampler::Initialize : non-positive dimension or number of replicates");
+	
+	CleanUp();
+	
+	mDimension = dimension;
+	mNumReplicates = numReplicates;
+	mDigitalShift = (dimension <= SOBOL_MAX_DIMENSION);
+	
+	if (mDigitalShift)
+		mpQRNG = gsl_qrng_alloc(gsl_qrng_sobol, dimension);
+	else
+		mpQRNG = gsl_qrng_alloc(gsl_qrng_halton, dimension);
+	
+	if (mpQRNG == NULL)
+		ThrowException("QuasiRandomSampler::Initialize : gsl_qrng allocation failed for dimension " + 
+					   ConvertIntegerToString(dimension));
+	
+	// 32 random bits per coordinate and replicate
+	mShift.SetSize(numReplicates * dimension);
+	for (long i = 0; i < mShift.Size(); ++i)
+		mShift[i] = (unsigned int) (gsl_rng_uniform(pRNG) * TWO_TO_32);
+	
+	mBase.SetSize(dimension);
+	Start(0);
+	
+	return;
+}
+
+
+
+void QuasiRandomSampler::CleanUp()
+{
+	if (mpQRNG != NULL)
+		gsl_qrng_free(mpQRNG);
+	
+	mpQRNG = NULL;
+	
+	return;
+}
+
+
+
+void QuasiRandomSampler::Start(long replicate, long index)
+{
+	if (mpQRNG == NULL)
+		ThrowException("QuasiRandomSampler::Start : not initialized");
+	
+	if (replicate < 0 || replicate >= mNumReplicates || index < 0)
+		ThrowException("QuasiRandomSampler::Start : replicate or index out of range");
+	
+	mReplicate = replicate;
+	mIndex = index;
+	
+	gsl_qrng_init(mpQRNG);
+	for (long i = 0; i < index; ++i)
+		gsl_qrng_get(mpQRNG, mBase.Begin());
+	
+	return;
+}
+
+
+
+void QuasiRandomSampler::Next(double u[])
+{
+	gsl_qrng_get(mpQRNG, mBase.Begin());
+	
+	const unsigned int *shift = mShift.Begin() + mReplicate * mDimension;
+	
+	for (long j = 0; j < mDimension; ++j) {
+		// the sobol points have (at most) 30 binary digits, so this is exact
+		unsigned int digits = (unsigned int) (mBase[j] * TWO_TO_32);
+		
+		if (mDigitalShift)
+			digits ^= shift[j];
+		else
+			digits += shift[j];
+		
+		u[j] = (digits + 0.5) / TWO_TO_32;
+	}
+	
+	++mIndex;
+	
+	return;
+}
+
+
+
+string QuasiRandomSampler::SequenceName() const
+{
+	return mDigitalShift ? "sobol" : "halton";
+}
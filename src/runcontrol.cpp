@@ -22,6 +22,9 @@
 #include <iostream>
 #include <vector>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace NAMESPACE;
 using namespace std;
 
@@ -49,6 +52,59 @@ void RunControl::SetSystemType(string systemType)
 
 
 
+void RunControl::SetRHSMethod(string rhsMethod)
+{
+	if (rhsMethod == "direct") {
+		mRHSMethod = DIRECT_RHS;
+		return;
+	}
+	
+	if (rhsMethod == "fft") {
+		mRHSMethod = FFT_RHS;
+		return;
+	}
+	
+	if (rhsMethod == "simd") {
+		mRHSMethod = SIMD_RHS;
+		return;
+	}
+	
+	ThrowException("RunControl::SetRHSMethod : bad input string = " + rhsMethod);
+	
+	return;
+}
+
+
+
+void RunControl::SetModeFileFormat(string format)
+{
+	if (format == "text") {
+		mModeFileFormat = TEXT_MODE_FILE;
+		return;
+	}
+	
+	if (format == "binary") {
+		mModeFileFormat = BINARY_MODE_FILE;
+		return;
+	}
+	
+	if (format == "binary32") {
+		mModeFileFormat = BINARY32_MODE_FILE;
+		return;
+	}
+	
+	if (format == "chunked") {
+		mModeFileFormat = CHUNKED_MODE_FILE;
+		return;
+	}
+	
+	ThrowException("RunControl::SetModeFileFormat : bad input string = " + format);
+	
+	return;
+}
+
+
+
 void RunControl::MakeOutputSchedule(double timeStep)
 {
 	switch (mOutputScheduleMode) {
@@ -150,4 +206,55 @@ void RunControl::PrintRunCount(long runCount) const
 	
 		
 	return;
-}
\ No newline at end of file
+}
+
+
+
+long long RunControl::OutputStreamSize(OutputFileStreamType streamType)
+{
+	// bytes on disk after a flush, -1 when the stream isn't open. the file size rather
+	// than tellp, which an append stream only knows once it has written
+	std::ofstream &fileStream = mOutputStream[streamType];
+	if (fileStream.is_open() == false)
+		return -1;
+	
+	fileStream.flush();
+	
+	struct stat status;
+	if (fileStream.fail() || stat(mOutputFileName[streamType].c_str(), &status) != 0)
+		ThrowException("RunControl::OutputStreamSize : could not flush " + mOutputFileName[streamType]);
+	
+	return status.st_size;
+}
+
+
+
+void RunControl::TruncateOutputStream(OutputFileStreamType streamType, long long size)
+{
+	// drops what a restarted run's stream got after the checkpoint, size < 0 means the
+	// stream wasn't open then
+	std::ofstream &fileStream = mOutputStream[streamType];
+	if (fileStream.is_open() == false)
+		return;
+	
+	if (size < 0)
+		size = 0;
+	
+	fileStream.close();
+	
+	const string &fileName = mOutputFileName[streamType];
+	
+	struct stat status;
+	if (stat(fileName.c_str(), &status) != 0 || status.st_size < size)
+		ThrowException("RunControl::TruncateOutputStream : " + fileName + " is shorter than at the checkpoint");
+	
+	if (truncate(fileName.c_str(), size) != 0)
+		ThrowException("RunControl::TruncateOutputStream : could not truncate " + fileName);
+	
+	fileStream.clear();
+	fileStream.open(fileName.c_str(), ios::out | ios::app);
+	if (fileStream.is_open() == false)
+		ThrowException("RunControl::TruncateOutputStream : could not open " + fileName);
+	
+	return;
+}
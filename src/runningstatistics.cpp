@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "runningstatistics.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+void RunningStatistics::Initialize(long size)
+{
+	if (size < 0)
+		ThrowException("RunningStatistics::Initialize : negative size");
+	
+	mMean.SetSize(size);
+	Reset();
+	
+	return;
+}
+
+
+
+void RunningStatistics::Reset()
+{
+	mCount = 0;
+	
+	for (long i = 0; i < mMean.Size(); ++i)
+		mMean[i] = 0.0;
+	
+	return;
+}
+
+
+
+void RunningStatistics::Add(const Array<double> &sample)
+{
+	if (sample.Size() != mMean.Size())
+		ThrowException("RunningStatistics::Add : sample has wrong size");
+	
+	++mCount;
+	double f = 1.0 / mCount;
+	
+	for (long i = 0; i < mMean.Size(); ++i)
+		mMean[i] += f * (sample[i] - mMean[i]);
+	
+	return;
+}
+
+
+
+void RunningStatistics::Merge(const RunningStatistics &statistics)
+{
+	Merge(statistics.mCount, statistics.mMean);
+	return;
+}
+
+
+
+void RunningStatistics::Merge(long count, const Array<double> &mean)
+{
+	if (count == 0)
+		return;
+	
+	if (mean.Size() != Size())
+		ThrowException("RunningStatistics::Merge : accumulators have different sizes");
+	
+	long total = mCount + count;
+	double f = (double) count / total;
+	
+	for (long i = 0; i < mMean.Size(); ++i)
+		mMean[i] += f * (mean[i] - mMean[i]);
+	
+	mCount = total;
+	
+	return;
+}
+
+
+
+void RunningStatistics::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	checkpoint.WriteInteger(mCount);
+	checkpoint.WriteArray(mMean);
+	
+	return;
+}
+
+
+
+void RunningStatistics::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	long count = checkpoint.ReadInteger();
+	
+	Array<double> mean;
+	checkpoint.ReadArray(mean);
+	
+	if (count < 0 || mean.Size() != mMean.Size())
+		ThrowException("RunningStatistics::ReadCheckpoint : checkpoint doesn't match the accumulator");
+	
+	mCount = count;
+	mMean = mean;
+	
+	return;
+}
@@ -67,6 +67,38 @@ void System::CleanUpSolver()
 
 
 
+void System::WriteCheckpoint(Checkpoint &checkpoint) const
+{
+	checkpoint.WriteDouble(mCurrentTime);
+	checkpoint.WriteArray(mMode);
+	checkpoint.WriteArray(mInitialCondition);
+	mIntegrator.WriteCheckpoint(checkpoint);
+	
+	return;
+}
+
+
+
+void System::ReadCheckpoint(Checkpoint &checkpoint)
+{
+	Array<double> mode, initialCondition;
+	
+	mCurrentTime = checkpoint.ReadDouble();
+	checkpoint.ReadArray(mode);
+	checkpoint.ReadArray(initialCondition);
+	
+	if (mode.Size() != mMode.Size() || initialCondition.Size() != mInitialCondition.Size())
+		ThrowException("System::ReadCheckpoint : checkpoint has the wrong number of modes");
+	
+	mMode = mode;
+	mInitialCondition = initialCondition;
+	mIntegrator.ReadCheckpoint(checkpoint);
+	
+	return;
+}
+
+
+
 void System::SetInitialConditions(const Array<double> &ic)
 {
 	if (ic.Size() != mInitialCondition.Size())
@@ -81,7 +113,10 @@ void System::SetInitialConditions(const Array<double> &ic)
 
 void System::SetToInitialCondition()
 {
+	// a new trajectory, so the solver starts over too
 	mMode = mInitialCondition;
+	mIntegrator.Reset();
+	
 	return;
 }
 
@@ -104,6 +139,18 @@ void System::SetNumModes(long numModes)
 
 
 
+void System::SetModes(const Array<double> &modes)
+{
+	if (modes.Size() != mMode.Size())
+		ThrowException("System::SetModes : mode array wrong size");
+	
+	mMode = modes;
+	
+	return;
+}
+
+
+
 double System::ResolvedNoise(long index) const
 {
 	// for Burgers equation
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "threadpool.h"
+
+using namespace NAMESPACE;
+using namespace std;
+
+ThreadPool::ThreadPool(const ThreadPool &pool)
+{
+	ThrowException("ThreadPool : copy constructor not implemented");
+	return;
+}
+
+
+
+void ThreadPool::Initialize(long numThreads)
+{
+	CleanUp();
+	
+	if (numThreads <= 0)
+		numThreads = thread::hardware_concurrency();
+	
+	if (numThreads <= 0)
+		numThreads = 1;
+	
+	mNumThreads = numThreads;
+	mpQueue = new TaskQueue[numThreads];
+	mStop = false;
+	
+	// the calling thread is worker 0
+	for (long i = 1; i < numThreads; ++i)
+		mThread.push_back(thread(&ThreadPool::WorkerLoop, this, i, mGeneration));
+	
+	return;
+}
+
+
+
+void ThreadPool::CleanUp()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+		mStop = true;
+	}
+	mStartCondition.notify_all();
+	
+	for (unsigned long i = 0; i < mThread.size(); ++i)
+		mThread[i].join();
+	
+	mThread.clear();
+	
+	delete [] mpQueue;
+	mpQueue = NULL;
+	
+	mNumThreads = 1;
+	
+	return;
+}
+
+
+
+void ThreadPool::Run(ThreadPoolTask &task, long numTasks)
+{
+	if (numTasks <= 0)
+		return;
+	
+	// not initialized
+	long numWorkers = (mpQueue == NULL) ? 0 : mNumThreads;
+	if (numWorkers == 0) {
+		for (long i = 0; i < numTasks; ++i)
+			task.Execute(i, 0);
+		
+		return;
+	}
+	
+	{
+		lock_guard<mutex> lock(mMutex);
+		
+		// deal the tasks out in contiguous blocks
+		for (long w = 0; w < mNumThreads; ++w) {
+			lock_guard<mutex> queueLock(mpQueue[w].mMutex);
+			mpQueue[w].mTask.clear();
+			
+			long begin = (w * numTasks) / mNumThreads;
+			long end = ((w + 1) * numTasks) / mNumThreads;
+			for (long i = begin; i < end; ++i)
+				mpQueue[w].mTask.push_back(i);
+		}
+		
+		mpTask = &task;
+		mFailedTask = -1;
+		mException = exception_ptr();
+		mNumBusyWorkers = mNumThreads - 1;
+		++mGeneration;
+	}
+	mStartCondition.notify_all();
+	
+	ExecuteTasks(0);
+	
+	exception_ptr exception;
+	{
+		unique_lock<mutex> lock(mMutex);
+		while (mNumBusyWorkers > 0)
+			mDoneCondition.wait(lock);
+		
+		mpTask = NULL;
+		exception = mException;
+		mException = exception_ptr();
+	}
+	
+	if (exception)
+		rethrow_exception(exception);
+	
+	return;
+}
+
+
+
+void ThreadPool::WorkerLoop(long worker, unsigned long generation)
+{
+	// generation is the last batch this worker has seen
+	while (true) {
+		{
+			unique_lock<mutex> lock(mMutex);
+			while (mStop == false && mGeneration == generation)
+				mStartCondition.wait(lock);
+			
+			if (mStop)
+				return;
+			
+			generation = mGeneration;
+		}
+		
+		ExecuteTasks(worker);
+		
+		{
+			lock_guard<mutex> lock(mMutex);
+			--mNumBusyWorkers;
+		}
+		mDoneCondition.notify_one();
+	}
+	
+	return;
+}
+
+
+
+void ThreadPool::ExecuteTasks(long worker)
+{
+	long taskIndex;
+	while (NextTask(worker, taskIndex)) {
+		try {
+			mpTask->Execute(taskIndex, worker);
+		}
+		catch (...) {
+			lock_guard<mutex> lock(mMutex);
+			if (mFailedTask < 0 || taskIndex < mFailedTask) {
+				mFailedTask = taskIndex;
+				mException = current_exception();
+			}
+		}
+	}
+	
+	return;
+}
+
+
+
+bool ThreadPool::NextTask(long worker, long &taskIndex)
+{
+	// own queue first, in order
+	{
+		TaskQueue &queue = mpQueue[worker];
+		lock_guard<mutex> lock(queue.mMutex);
+		if (queue.mTask.empty() == false) {
+			taskIndex = queue.mTask.front();
+			queue.mTask.pop_front();
+			return true;
+		}
+	}
+	
+	// then steal from the back of the others
+	for (long i = 1; i < mNumThreads; ++i) {
+		TaskQueue &queue = mpQueue[(worker + i) % mNumThreads];
+		lock_guard<mutex> lock(queue.mMutex);
+		if (queue.mTask.empty() == false) {
+			taskIndex = queue.mTask.back();
+			queue.mTask.pop_back();
+			return true;
+		}
+	}
+	
+	return false;
+}
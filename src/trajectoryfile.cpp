@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2004-2018 David Bernstein <david.h.bernstein@gmail.com>
+ *
+ * This file is part of OPBE.
+ *
+ * OPBE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OPBE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OPBE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trajectoryfile.h"
+#include "opbeconst.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+using namespace NAMESPACE;
+using namespace std;
+
+static const char TRAJECTORY_MAGIC[8] = "OPBETRJ";
+static const uint32_t TRAJECTORY_VERSION = 1;
+static const uint32_t TRAJECTORY_BYTE_ORDER_MARK = 0x01020304;
+
+// magic, four uint32 and three int64
+static const long TRAJECTORY_FIXED_HEADER_SIZE = 8 + 4 * 4 + 3 * 8;
+
+TrajectoryWriter::TrajectoryWriter(const TrajectoryWriter &writer)
+{
+	ThrowException("TrajectoryWriter : copy constructor not implemented");
+	return;
+}
+
+
+
+void TrajectoryWriter::Open(const string &fileName, long numModes, long numSystems, 
+							const Array<double> &time, bool singlePrecision)
+{
+	if (numModes <= 0 || numSystems <= 0)
+		ThrowException("TrajectoryWriter::Open : non-positive number of modes or systems");
+	
+	Close();
+	
+	mFile.open(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+	if (mFile.is_open() == false)
+		ThrowException("TrajectoryWriter::Open : could not open " + fileName);
+	
+	mNumModes = numModes;
+	mNumSystems = numSystems;
+	mNumTimes = time.Size();
+	mSinglePrecision = singlePrecision;
+	mNumRecords = 0;
+	
+	// header
+	uint32_t word[4] = {TRAJECTORY_VERSION, TRAJECTORY_BYTE_ORDER_MARK, 
+						(uint32_t) (singlePrecision ? sizeof(float) : sizeof(double)), 0};
+	int64_t size[3] = {numModes, numSystems, mNumTimes};
+	
+	mFile.write(TRAJECTORY_MAGIC, 8);
+	mFile.write((const char *) word, sizeof(word));
+	mFile.write((const char *) size, sizeof(size));
+	
+	for (long n = 0; n < mNumTimes; ++n) {
+		double t = time[n];
+		mFile.write((const char *) &t, sizeof(double));
+	}
+	
+	if (mFile.fail())
+		ThrowException("TrajectoryWriter::Open : could not write header to " + fileName);
+	
+	AllocateBuffer();
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::Resume(const string &fileName, long numModes, long numSystems, 
+							  const Array<double> &time, bool singlePrecision, long numTimesWritten)
+{
+	if (numModes <= 0 || numSystems <= 0 || numTimesWritten < 0 || numTimesWritten > time.Size())
+		ThrowException("TrajectoryWriter::Resume : bad sizes");
+	
+	Close();
+	
+	// the header has to be the one Open would write
+	ifstream file(fileName.c_str(), ios::in | ios::binary);
+	if (file.is_open() == false)
+		ThrowException("TrajectoryWriter::Resume : could not open " + fileName);
+	
+	char magic[8];
+	uint32_t word[4];
+	int64_t size[3];
+	
+	file.read(magic, 8);
+	file.read((char *) word, sizeof(word));
+	file.read((char *) size, sizeof(size));
+	
+	uint32_t valueSize = singlePrecision ? sizeof(float) : sizeof(double);
+	if (file.fail() || memcmp(magic, TRAJECTORY_MAGIC, 8) != 0 || word[0] != TRAJECTORY_VERSION || 
+		word[1] != TRAJECTORY_BYTE_ORDER_MARK || word[2] != valueSize)
+		ThrowException("TrajectoryWriter::Resume : " + fileName + " is not a trajectory file in the mode file format");
+	
+	if (size[0] != numModes || size[1] != numSystems || size[2] != time.Size())
+		ThrowException("TrajectoryWriter::Resume : " + fileName + " has different sizes");
+	
+	for (long n = 0; n < time.Size(); ++n) {
+		double t;
+		file.read((char *) &t, sizeof(double));
+		if (file.fail() || t != time[n])
+			ThrowException("TrajectoryWriter::Resume : " + fileName + " has a different output schedule");
+	}
+	
+	// the records of the output times written, anything after them is dropped
+	long long dataOffset = TRAJECTORY_FIXED_HEADER_SIZE + (long long) time.Size() * sizeof(double);
+	long long dataSize = (long long) numTimesWritten * numSystems * numModes * valueSize;
+	
+	file.seekg(0, ios::end);
+	long long fileSize = file.tellg();
+	file.close();
+	
+	if (fileSize < dataOffset + dataSize)
+		ThrowException("TrajectoryWriter::Resume : " + fileName + " is shorter than the restart needs");
+	
+	if (truncate(fileName.c_str(), dataOffset + dataSize) != 0)
+		ThrowException("TrajectoryWriter::Resume : could not truncate " + fileName);
+	
+	mFile.open(fileName.c_str(), ios::out | ios::binary | ios::app);
+	if (mFile.is_open() == false)
+		ThrowException("TrajectoryWriter::Resume : could not open " + fileName);
+	
+	mNumModes = numModes;
+	mNumSystems = numSystems;
+	mNumTimes = time.Size();
+	mSinglePrecision = singlePrecision;
+	mNumRecords = numTimesWritten * numSystems;
+	
+	AllocateBuffer();
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::AllocateBuffer()
+{
+	// room for at least one record
+	long recordBytes = mNumModes * (mSinglePrecision ? sizeof(float) : sizeof(double));
+	long capacity = TRAJECTORY_BUFFER_SIZE;
+	if (capacity < recordBytes)
+		capacity = recordBytes;
+	
+	mBuffer.SetSize(capacity);
+	mBufferSize = 0;
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::Close()
+{
+	if (mFile.is_open() == false)
+		return;
+	
+	Flush();
+	mFile.close();
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::Write(const Array<double> &mode)
+{
+	if (mode.Size() != mNumModes)
+		ThrowException("TrajectoryWriter::Write : record has wrong size");
+	
+	Write(mode.Begin());
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::Write(const double mode[])
+{
+	if (mFile.is_open() == false)
+		ThrowException("TrajectoryWriter::Write : file not open");
+	
+	long recordBytes = mNumModes * (mSinglePrecision ? sizeof(float) : sizeof(double));
+	if (mBufferSize + recordBytes > mBuffer.Size())
+		Flush();
+	
+	char *p = mBuffer.Begin() + mBufferSize;
+	
+	if (mSinglePrecision) {
+		for (long i = 0; i < mNumModes; ++i) {
+			float x = (float) mode[i];
+			memcpy(p + i * sizeof(float), &x, sizeof(float));
+		}
+	}
+	else {
+		memcpy(p, mode, recordBytes);
+	}
+	
+	mBufferSize += recordBytes;
+	++mNumRecords;
+	
+	return;
+}
+
+
+
+void TrajectoryWriter::Flush()
+{
+	if (mBufferSize == 0)
+		return;
+	
+	mFile.write(mBuffer.Begin(), mBufferSize);
+	mFile.flush();
+	
+	if (mFile.fail())
+		ThrowException("TrajectoryWriter::Flush : write failed");
+	
+	mBufferSize = 0;
+	
+	return;
+}
+
+
+
+TrajectoryReader::TrajectoryReader(const TrajectoryReader &reader)
+{
+	ThrowException("TrajectoryReader : copy constructor not implemented");
+	return;
+}
+
+
+
+void TrajectoryReader::Open(const string &fileName)
+{
+	Close();
+	
+	mFile.open(fileName.c_str(), ios::in | ios::binary);
+	if (mFile.is_open() == false)
+		ThrowException("TrajectoryReader::Open : could not open " + fileName);
+	
+	char magic[8];
+	uint32_t word[4];
+	int64_t size[3];
+	
+	mFile.read(magic, 8);
+	mFile.read((char *) word, sizeof(word));
+	mFile.read((char *) size, sizeof(size));
+	
+	if (mFile.fail() || memcmp(magic, TRAJECTORY_MAGIC, 8) != 0)
+		ThrowException("TrajectoryReader::Open : " + fileName + " is not a trajectory file");
+	
+	if (word[0] != TRAJECTORY_VERSION)
+		ThrowException("TrajectoryReader::Open : unknown version in " + fileName);
+	
+	if (word[1] != TRAJECTORY_BYTE_ORDER_MARK)
+		ThrowException("TrajectoryReader::Open : " + fileName + " was written with a different byte order");
+	
+	if (word[2] != sizeof(float) && word[2] != sizeof(double))
+		ThrowException("TrajectoryReader::Open : bad value size in " + fileName);
+	
+	mSinglePrecision = (word[2] == sizeof(float));
+	mNumModes = size[0];
+	mNumSystems = size[1];
+	mNumTimes = size[2];
+	
+	if (mNumModes <= 0 || mNumSystems <= 0 || mNumTimes < 0)
+		ThrowException("TrajectoryReader::Open : bad sizes in " + fileName);
+	
+	mTime.SetSize(mNumTimes);
+	for (long n = 0; n < mNumTimes; ++n)
+		mFile.read((char *) &mTime[n], sizeof(double));
+	
+	if (mFile.fail())
+		ThrowException("TrajectoryReader::Open : truncated header in " + fileName);
+	
+	mDataOffset = TRAJECTORY_FIXED_HEADER_SIZE + (long long) mNumTimes * sizeof(double);
+	
+	// complete records in the file
+	mFile.seekg(0, ios::end);
+	long long fileSize = mFile.tellg();
+	long long recordBytes = (long long) mNumModes * word[2];
+	mNumRecords = (long) ((fileSize - mDataOffset) / recordBytes);
+	
+	if (mSinglePrecision)
+		mFloatBuffer.SetSize(mNumModes);
+	
+	return;
+}
+
+
+
+void TrajectoryReader::Close()
+{
+	if (mFile.is_open())
+		mFile.close();
+	
+	mFile.clear();
+	mNumRecords = 0;
+	
+	return;
+}
+
+
+
+void TrajectoryReader::Read(long n, long system, Array<double> &mode)
+{
+	if (n < 0 || n >= mNumTimes || system < 0 || system >= mNumSystems)
+		ThrowException("TrajectoryReader::Read : record out of range");
+	
+	long record = n * mNumSystems + system;
+	if (record >= mNumRecords)
+		ThrowException("TrajectoryReader::Read : record not in file");
+	
+	long valueBytes = mSinglePrecision ? sizeof(float) : sizeof(double);
+	mFile.seekg(mDataOffset + (long long) record * mNumModes * valueBytes, ios::beg);
+	
+	mode.SetSize(mNumModes);
+	
+	if (mSinglePrecision) {
+		mFile.read((char *) mFloatBuffer.Begin(), mNumModes * valueBytes);
+		for (long i = 0; i < mNumModes; ++i)
+			mode[i] = mFloatBuffer[i];
+	}
+	else {
+		mFile.read((char *) mode.Begin(), mNumModes * valueBytes);
+	}
+	
+	if (mFile.fail())
+		ThrowException("TrajectoryReader::Read : read failed");
+	
+	return;
+}